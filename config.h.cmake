@@ -8,4 +8,7 @@
 #define IPX800_VERSION_MAJOR @IPX800_VERSION_MAJOR@
 #define IPX800_VERSION_MINOR @IPX800_VERSION_MINOR@
 
+/* Trace level logging compiled in */
+#cmakedefine IPX800_TRACE_LOG
+
 #endif // CONFIG_H
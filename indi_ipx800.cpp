@@ -29,6 +29,8 @@ User can select, partially, for this first release, how IPX 800 is configured
 
 #include "indicom.h"
 #include "config.h"
+#include "ipx800_log.h"
+#include "ipx800_decode.h"
 
 #include "connectionplugins/connectiontcp.h"
 
@@ -45,6 +47,10 @@ User can select, partially, for this first release, how IPX 800 is configured
 #include <thread>
 #include <functional>
 #include <regex>
+#include <fstream>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/time.h>
 
 //Network related includes:
 #include <sys/socket.h>
@@ -54,6 +60,53 @@ User can select, partially, for this first release, how IPX 800 is configured
 
 
 #define DEFAULT_POLLING_TIMER 2000
+// Polling period while the roof is moving (ms)
+#define ROOF_MOTION_POLLING_TIMER 250
+// Maximum roof travel time before engine power is cut (s)
+#define DEFAULT_ROOF_TIMEOUT 40
+// Duration of ROOF_CONTROL_COMMAND pulse sent by Dome interface (ms)
+#define ROOF_COMMAND_PULSE 500
+// Wait after a pulse stopping the roof, before it is commanded the other way (ms)
+#define ROOF_STOP_SETTLE 1500
+// Time mount park inputs must be stable before Mount_Status changes (ms)
+#define DEFAULT_MOUNT_DEBOUNCE 1000
+// Maximum wait of a power sequence step for its confirmation input (ms)
+#define POWER_CONFIRM_TIMEOUT 60000
+
+// Interlock word layout
+#define INTERLOCK_RELAY_BIT(f)    (1u << (f))          // relay functions 1..10 switched on
+#define INTERLOCK_DIGITAL_BIT(f)  (1u << (11 + (f)))   // digital functions 1..9 active
+#define INTERLOCK_BOTH_PARKED     (1u << 24)
+#define INTERLOCK_ROOF_OPENED     (1u << 25)
+#define INTERLOCK_ROOF_CLOSED     (1u << 26)
+
+// Function names, as used in interlock rules, ordered as IPXRelaysCommands / IPXDigitalRead
+static const char *RelayFunctionNames[11] = {
+    "UNUSED_RELAY", "ROOF_ENGINE_POWER_SUPPLY", "TUBE_VENTILATION", "HEATING_RESISTOR_1", "HEATING_RESISTOR_2",
+    "ROOF_CONTROL_COMMAND", "MOUNT_POWER_SUPPLY", "CAM_POWER_SUPPLY", "OTHER_POWER_SUPPLY_1", "OTHER_POWER_SUPPLY_2",
+    "OTHER_POWER_SUPPLY_3"
+};
+static const char *DigitalFunctionNames[10] = {
+    "UNUSED_DIGIT", "DEC_AXIS_PARKED", "RA_AXIS_PARKED", "ROOF_OPENED", "ROOF_CLOSED", "ROOF_ENGINE_POWERED",
+    "RASPBERRY_SUPPLIED", "MAIN_PC_SUPPLIED", "OTHER_DIGITAL_1", "OTHER_DIGITAL_2"
+};
+
+// Blanks removed around a rule / sequence token
+static std::string trimToken(std::string token)
+{
+    token.erase(0, token.find_first_not_of(" \t\r\n"));
+    token.erase(token.find_last_not_of(" \t\r\n") + 1);
+    return token;
+}
+
+// Function index from its name in RelayFunctionNames / DigitalFunctionNames, -1 if unknown
+static int findFunction(const char *const names[], int count, const std::string &token)
+{
+    for (int f=1;f<count;f++)
+        if (strcasecmp(token.c_str(), names[f]) == 0)
+            return f;
+    return -1;
+}
 
 // Read only
 #define ROOF_OPENED_SWITCH 0
@@ -72,14 +125,129 @@ std::unique_ptr<Ipx800> ipx800(new Ipx800());
 
 void ISPoll(void *p);
 
+static void relayTimersHelper(int fd, void *p)
+{
+    INDI_UNUSED(fd);
+    static_cast<Ipx800 *>(p)->expireRelayTimers();
+}
+
+// Numbers of a batched answer "X1=xxx&X2=xxx&...", in order. Returns how many were read.
+static int parseAnswerFields(const char *answer, double *values, int maxValues)
+{
+    int found = 0;
+    const char *p = answer;
+    while (*p != '\0' && found < maxValues) {
+        const char *eq = strchr(p, '=');
+        const char *field = eq ? eq + 1 : p;
+        char *endField = nullptr;
+        double value = strtod(field, &endField);
+        if (endField != field)
+            values[found++] = value;
+        const char *next = strchr(field, '&');
+        if (next == nullptr)
+            break;
+        p = next + 1;
+    }
+    return found;
+}
+
+// Relay / digital input function selections, as named in saved configurations
+static const char *RelayFunctionLabels[] = {
+    "Unused", "Roof Engine Power", "Telescope Ventilation", "Heating Resistor 1", "Heating Resistor 2",
+    "Roof Control Command", "Mount Power Supply", "Camera Power Supply ", "Other Power Supply 1",
+    "Other Power Supply 2", "Other Power Supply 3"
+};
+static const char *DigitalFunctionLabels[] = {
+    "Unused", "DEC Axis Parked", "RA Axis Parked", "Roof Opened", "Roof Closed", "Roof Engine Supplied",
+    "Raspberry Power Supplied", "Main PC Supplied", "Other Digital 1", "Other Digital 2"
+};
+
+const Ipx800::ChannelKind Ipx800::channelKinds[CHANNEL_KINDS] = {
+    { "RELAY_%d_CONFIGURATION", "RELAIS_%d_CONFIGURATION", "Relay %d", "Relays Outputs",
+      RelayFunctionLabels, 11, "RELAY_%d_STATE", RelayFunctionNames, "RELAYS_FUNCTIONS", "RELAYS_STATES", "Relays" },
+    { "DIGITAL_%d_CONFIGURATION", nullptr, "Digital %d", "Digital Inputs",
+      DigitalFunctionLabels, 10, "DIGIT_%d_STATE", DigitalFunctionNames, "DIGITALS_FUNCTIONS", "DIGITALS_STATES", "Digital Inputs" }
+};
+
+// Leading '0' / '1' characters of an answer
+static size_t statusLength(const char *reply, size_t length)
+{
+    size_t n = 0;
+    while (n < length && (reply[n] == '0' || reply[n] == '1'))
+        n++;
+    return n;
+}
+
+// Probe answers : a V4 answers Get=R with one '0' / '1' per relay, a V3 answers GetOutputs
+// with "GetOutputs=" then the relays, a V5 serves its API over HTTP (401 without API key).
+// V3 / V4 web servers answer on port 80 too : the HTTP answer only wins when no M2M probe answered
+static bool acceptV3(const char *reply, size_t length)
+{
+    static const char prefix[] = "GetOutputs=";
+    const size_t prefixLength = sizeof(prefix) - 1;
+    if (length <= prefixLength || memcmp(reply, prefix, prefixLength) != 0)
+        return false;
+    size_t relays = statusLength(reply + prefixLength, length - prefixLength);
+    return relays >= 8 && prefixLength + relays < length && strchr("\r\n", reply[prefixLength + relays]) != nullptr;
+}
+static bool acceptV4(const char *reply, size_t length)
+{
+    size_t relays = statusLength(reply, length);
+    return relays >= 8 && relays < length && strchr("\r\n", reply[relays]) != nullptr;
+}
+static bool acceptV5(const char *reply, size_t length)
+{
+    return length >= 12 && memcmp(reply, "HTTP/1.", 7) == 0
+           && (memcmp(reply + 9, "200", 3) == 0 || memcmp(reply + 9, "401", 3) == 0);
+}
+
+const Ipx800::Protocol Ipx800::protocols[PROTOCOLS] = {
+    { 3, { 0, "GetOutputs", acceptV3, false }, "GetOutputs", "GetInputs", nullptr, nullptr, "Set%02d1", "Set%02d0", true },
+    { 4, { 0, "Get=R", acceptV4, false }, "Get=R", "Get=D", "Get=A", "Get=C", "SetR=%02d", "ClearR=%02d", false },
+    // V5 is detected, its HTTP / JSON API is not driven yet
+    { 5, { 80, "GET /api/system/ipx HTTP/1.0\r\n\r\n", acceptV5, true }, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, false }
+};
+
+// Monotonic clock in ms, for debounce and timings
+static uint64_t monotonicMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+// wall clock, for what is kept across runs
+static uint64_t realtimeMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
 /*************************************************************************/
 /** Constructor                                                         **/
 /*************************************************************************/
 
 Ipx800::Ipx800() : INDI::InputInterface(this), INDI::OutputInterface(this)
 {
+	// properties point into these : never reallocated
+	for (int kind=0; kind<CHANNEL_KINDS; kind++) {
+		channelConfigS[kind].reserve(MAX_CHANNELS * channelKinds[kind].functions);
+		channelConfigSP[kind].reserve(MAX_CHANNELS);
+		channelStateS[kind].reserve(MAX_CHANNELS * 2);
+		channelStateSP[kind].reserve(MAX_CHANNELS);
+		channelFunctionT[kind].reserve(MAX_CHANNELS);
+		channelStateL[kind].reserve(MAX_CHANNELS);
+		std::fill(std::begin(functionChannel[kind]), std::end(functionChannel[kind]), -1);
+	}
+	DigitalFilterSamplesN.reserve(MAX_CHANNELS);
+	DigitalFilterTimeN.reserve(MAX_CHANNELS);
+	RelayAutoOffN.reserve(MAX_CHANNELS);
+	RelayWattsN.reserve(MAX_CHANNELS);
+	RelayUsageN.reserve(MAX_CHANNELS * 4);
     
 	Roof_Status = UNKNOWN_STATUS;
+	Roof_Motion = ROOF_STOPPED;
 	Mount_Status = NONE_PARKED;
 
 	setVersion(IPX800_VERSION_MAJOR,IPX800_VERSION_MINOR);
@@ -93,8 +261,27 @@ bool Ipx800::initProperties()
     LOG_INFO("Starting device...");
     
 	INDI::DefaultDevice::initProperties();
-	INDI::InputInterface::initProperties("Inputs&Outputs", DIGITAL_INTPUTS, 0, "Digital");
-    INDI::OutputInterface::initProperties("Inputs&Outputs", RELAYS_OUTPUTS, "Relay");
+	
+	// event log next to INDI config files, kept from one run to the next
+	const char *home = getenv("HOME");
+	std::string eventLogPath = std::string(home ? home : ".") + "/.indi/" + getDeviceName() + "_events.bin";
+	if (!eventLog.isOpen() && !eventLog.open(eventLogPath.c_str(), EVENT_LOG_RECORDS))
+		LOGF_WARN("Event log %s can't be opened, transitions won't be recorded", eventLogPath.c_str());
+	
+	// last verified state of the previous run, extensions included
+	std::string snapshotPath = std::string(home ? home : ".") + "/.indi/" + getDeviceName() + "_state.bin";
+	if (!stateSnapshot.isOpen() && !stateSnapshot.open(snapshotPath.c_str()))
+		LOGF_WARN("State file %s can't be opened, last known state won't be kept", snapshotPath.c_str());
+	
+	// relays usage counters, going on from one run to the next
+	std::string usagePath = std::string(home ? home : ".") + "/.indi/" + getDeviceName() + "_usage.bin";
+	if (!relayUsage.isOpen() && !relayUsage.open(usagePath.c_str()))
+		LOGF_WARN("Usage file %s can't be opened, relays usage won't be kept", usagePath.c_str());
+	
+	// roof runs learned so far
+	std::string roofRunsPath = std::string(home ? home : ".") + "/.indi/" + getDeviceName() + "_roof_runs.bin";
+	if (!roofRuns.isOpen() && !roofRuns.open(roofRunsPath.c_str()))
+		LOGF_WARN("Roof runs file %s can't be opened, roof runs won't be kept", roofRunsPath.c_str());
 		
    // SetParkDataType(PARK_NONE);
     //addDebugControl(); 
@@ -102,92 +289,62 @@ bool Ipx800::initProperties()
 	addConfigurationControl();
 	
 
-	//Rolling list of possible functions managed by relays
-    IUFillSwitch(&RelaisInfoS[0], "Unused", "",ISS_ON);
-    IUFillSwitch(&RelaisInfoS[1], "Roof Engine Power", "", ISS_OFF);
-    IUFillSwitch(&RelaisInfoS[2], "Telescope Ventilation", "", ISS_OFF);
-    IUFillSwitch(&RelaisInfoS[3], "Heating Resistor 1", "", ISS_OFF);
-    IUFillSwitch(&RelaisInfoS[4], "Heating Resistor 2", "", ISS_OFF);
-    IUFillSwitch(&RelaisInfoS[5], "Roof Control Command", "", ISS_OFF);
-    IUFillSwitch(&RelaisInfoS[6], "Mount Power Supply", "", ISS_OFF);
-    IUFillSwitch(&RelaisInfoS[7], "Camera Power Supply ", "", ISS_OFF);
-    IUFillSwitch(&RelaisInfoS[8], "Other Power Supply 1", "", ISS_OFF);
-    IUFillSwitch(&RelaisInfoS[9], "Other Power Supply 2", "", ISS_OFF);
-    IUFillSwitch(&RelaisInfoS[10], "Other Power Supply 3", "", ISS_OFF);
-    
-	//set default value of each relay 
-	for(int i=0;i<11;i++)
+	// Relays and digital inputs of a bare IPX800, or as last seen : extensions are checked at Handshake
+	const StateSnapshot::State &lastState = stateSnapshot.state();
+	if (stateSnapshot.hasState())
+		buildChannels(std::min(std::max<int>(lastState.relays, BASE_CHANNELS), MAX_CHANNELS),
+		              std::min(std::max<int>(lastState.digitals, BASE_CHANNELS), MAX_CHANNELS));
+	else
+		buildChannels(BASE_CHANNELS, BASE_CHANNELS);
+	INDI::InputInterface::initProperties("Inputs&Outputs", digitalCount, ANALOG_INPUTS, "Digital");
+    INDI::OutputInterface::initProperties("Inputs&Outputs", relayCount, "Relay");
+
+	// Analog inputs scaling, deadband and statistics over the last ANALOG_WINDOW polls
+    for(int i=0;i<ANALOG_INPUTS;i++)
     {
-        Relais1InfoS[i] = RelaisInfoS[i];
-        Relais2InfoS[i] = RelaisInfoS[i];
-        Relais3InfoS[i] = RelaisInfoS[i];
-        Relais4InfoS[i] = RelaisInfoS[i];
-        Relais5InfoS[i] = RelaisInfoS[i];
-        Relais6InfoS[i] = RelaisInfoS[i];
-        Relais7InfoS[i] = RelaisInfoS[i];
-        Relais8InfoS[i] = RelaisInfoS[i];
+        char analogName[MAXINDINAME], analogLabel[MAXINDILABEL];
+        snprintf(analogName, MAXINDINAME, "GAIN_%d", i+1);
+        snprintf(analogLabel, MAXINDILABEL, "Analog %d gain", i+1);
+        IUFillNumber(&AnalogScaleN[2*i], analogName, analogLabel, "%.6f", -1e6, 1e6, 0, 1);
+        snprintf(analogName, MAXINDINAME, "OFFSET_%d", i+1);
+        snprintf(analogLabel, MAXINDILABEL, "Analog %d offset", i+1);
+        IUFillNumber(&AnalogScaleN[2*i+1], analogName, analogLabel, "%.3f", -1e6, 1e6, 0, 0);
+        snprintf(analogName, MAXINDINAME, "DEADBAND_%d", i+1);
+        snprintf(analogLabel, MAXINDILABEL, "Analog %d", i+1);
+        IUFillNumber(&AnalogDeadbandN[i], analogName, analogLabel, "%.3f", 0, 1e6, 0, 0);
+        snprintf(analogName, MAXINDINAME, "MIN_%d", i+1);
+        snprintf(analogLabel, MAXINDILABEL, "Analog %d min", i+1);
+        IUFillNumber(&AnalogStatsN[3*i], analogName, analogLabel, "%.3f", -1e6, 1e6, 0, 0);
+        snprintf(analogName, MAXINDINAME, "MEAN_%d", i+1);
+        snprintf(analogLabel, MAXINDILABEL, "Analog %d mean", i+1);
+        IUFillNumber(&AnalogStatsN[3*i+1], analogName, analogLabel, "%.3f", -1e6, 1e6, 0, 0);
+        snprintf(analogName, MAXINDINAME, "MAX_%d", i+1);
+        snprintf(analogLabel, MAXINDILABEL, "Analog %d max", i+1);
+        IUFillNumber(&AnalogStatsN[3*i+2], analogName, analogLabel, "%.3f", -1e6, 1e6, 0, 0);
     }
-
-    //creation du selecteur de configuration des relais
-    IUFillSwitchVector(&RelaisInfoSP[0], Relais1InfoS, 11, getDeviceName(), "RELAY_1_CONFIGURATION", "Relay 1", RELAYS_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaisInfoSP[1], Relais2InfoS, 11, getDeviceName(), "RELAY_2_CONFIGURATION", "Relay 2", RELAYS_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaisInfoSP[2], Relais3InfoS, 11, getDeviceName(), "RELAY_3_CONFIGURATION", "Relay 3", RELAYS_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaisInfoSP[3], Relais4InfoS, 11, getDeviceName(), "RELAIS_4_CONFIGURATION", "Relay 4", RELAYS_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaisInfoSP[4], Relais5InfoS,11, getDeviceName(), "RELAIS_5_CONFIGURATION", "Relay 5", RELAYS_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaisInfoSP[5], Relais6InfoS, 11, getDeviceName(), "RELAIS_6_CONFIGURATION", "Relay 6", RELAYS_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaisInfoSP[6], Relais7InfoS,11, getDeviceName(), "RELAIS_7_CONFIGURATION", "Relay 7", RELAYS_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaisInfoSP[7], Relais8InfoS, 11, getDeviceName(), "RELAIS_8_CONFIGURATION", "Relay 8", RELAYS_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-
-    //creation liste deroulante entrees discretes
-    IUFillSwitch(&DigitalInputS[0], "Unused", "",ISS_ON);
-    IUFillSwitch(&DigitalInputS[1], "DEC Axis Parked", "", ISS_OFF);
-    IUFillSwitch(&DigitalInputS[2], "RA Axis Parked", "", ISS_OFF);
-    IUFillSwitch(&DigitalInputS[3], "Roof Opened", "", ISS_OFF);
-    IUFillSwitch(&DigitalInputS[4], "Roof Closed", "", ISS_OFF);
-    IUFillSwitch(&DigitalInputS[5], "Roof Engine Supplied", "", ISS_OFF);
-    IUFillSwitch(&DigitalInputS[6], "Raspberry Power Supplied", "", ISS_OFF);
-    IUFillSwitch(&DigitalInputS[7], "Main PC Supplied", "", ISS_OFF);
-    IUFillSwitch(&DigitalInputS[8], "Other Digital 1", "", ISS_OFF);
-    IUFillSwitch(&DigitalInputS[9], "Other Digital 2", "", ISS_OFF);
-	
-	//set default value of each digital input 
-    for(int i=0;i<10;i++)
+    IUFillNumberVector(&AnalogScaleNP, AnalogScaleN, ANALOG_INPUTS * 2, getDeviceName(), "ANALOG_SCALING", "Scaling",
+                       ANALOG_INPUT_CONFIGURATION_TAB, IP_RW, 0, IPS_IDLE);
+    IUFillNumberVector(&AnalogDeadbandNP, AnalogDeadbandN, ANALOG_INPUTS, getDeviceName(), "ANALOG_DEADBAND", "Deadband",
+                       ANALOG_INPUT_CONFIGURATION_TAB, IP_RW, 0, IPS_IDLE);
+    IUFillNumberVector(&AnalogStatsNP, AnalogStatsN, ANALOG_INPUTS * 3, getDeviceName(), "ANALOG_STATISTICS", "Analog Statistics",
+                       RAW_DATA_TAB, IP_RO, 0, IPS_IDLE);
+
+	// Pulse counters (anemometer, rain gauge...)
+    for(int i=0;i<COUNTERS;i++)
     {
-        Digital1InputS[i] = DigitalInputS[i];
-        Digital2InputS[i] = DigitalInputS[i];
-        Digital3InputS[i] = DigitalInputS[i];
-        Digital4InputS[i] = DigitalInputS[i];
-        Digital5InputS[i] = DigitalInputS[i];
-        Digital6InputS[i] = DigitalInputS[i];
-        Digital7InputS[i] = DigitalInputS[i];
-        Digital8InputS[i] = DigitalInputS[i];
+        char counterName[MAXINDINAME], counterLabel[MAXINDILABEL];
+        snprintf(counterName, MAXINDINAME, "COUNT_%d", i+1);
+        snprintf(counterLabel, MAXINDILABEL, "Counter %d total", i+1);
+        IUFillNumber(&CountersN[3*i], counterName, counterLabel, "%.0f", 0, 4294967295.0, 0, 0);
+        snprintf(counterName, MAXINDINAME, "RATE_S_%d", i+1);
+        snprintf(counterLabel, MAXINDILABEL, "Counter %d per s", i+1);
+        IUFillNumber(&CountersN[3*i+1], counterName, counterLabel, "%.3f", 0, 1e9, 0, 0);
+        snprintf(counterName, MAXINDINAME, "RATE_MIN_%d", i+1);
+        snprintf(counterLabel, MAXINDILABEL, "Counter %d per min", i+1);
+        IUFillNumber(&CountersN[3*i+2], counterName, counterLabel, "%.2f", 0, 1e9, 0, 0);
     }
-	
-	//creation du selecteur de configuration des entrées discretes
-    IUFillSwitchVector(&DigitalInputSP[0], Digital1InputS, 10, getDeviceName(), "DIGITAL_1_CONFIGURATION", "Digital 1", DIGITAL_INPUT_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitalInputSP[1], Digital2InputS, 10, getDeviceName(), "DIGITAL_2_CONFIGURATION", "Digital 2", DIGITAL_INPUT_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitalInputSP[2], Digital3InputS, 10, getDeviceName(), "DIGITAL_3_CONFIGURATION", "Digital 3", DIGITAL_INPUT_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitalInputSP[3], Digital4InputS, 10, getDeviceName(), "DIGITAL_4_CONFIGURATION", "Digital 4", DIGITAL_INPUT_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitalInputSP[4], Digital5InputS, 10, getDeviceName(), "DIGITAL_5_CONFIGURATION", "Digital 5", DIGITAL_INPUT_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitalInputSP[5], Digital6InputS, 10, getDeviceName(), "DIGITAL_6_CONFIGURATION", "Digital 6", DIGITAL_INPUT_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitalInputSP[6], Digital7InputS, 10, getDeviceName(), "DIGITAL_7_CONFIGURATION", "Digital 7", DIGITAL_INPUT_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitalInputSP[7], Digital8InputS, 10, getDeviceName(), "DIGITAL_8_CONFIGURATION", "Digital 8", DIGITAL_INPUT_CONFIGURATION_TAB,
-                     IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    IUFillNumberVector(&CountersNP, CountersN, COUNTERS * 3, getDeviceName(), "COUNTERS", "Counters",
+                       RAW_DATA_TAB, IP_RO, 0, IPS_IDLE);
 
     //TO Manage in a next release
     //IUFillText(&LoginPwdT[0], "LOGIN_VAL", "Login", "");
@@ -196,102 +353,24 @@ bool Ipx800::initProperties()
 	//defineProperty(&LoginPwdTP);
 	// 
 	
-    //enregistrement des onglets de configurations
-    for(int i=0;i<8;i++)
-    {
-        defineProperty(&RelaisInfoSP[i]);
-        defineProperty(&DigitalInputSP[i]);
-    }
+	// Channels used at most, when extensions are not all wired
+    IUFillNumber(&ChannelLimitN[0], "RELAYS", "Relays (0 = all)", "%.0f", 0, MAX_CHANNELS, 8, 0);
+    IUFillNumber(&ChannelLimitN[1], "DIGITALS", "Digital inputs (0 = all)", "%.0f", 0, MAX_CHANNELS, 8, 0);
+    IUFillNumberVector(&ChannelLimitNP, ChannelLimitN, 2, getDeviceName(), "CHANNEL_LIMIT", "Channels", "Options",
+                       IP_RW, 0, IPS_IDLE);
+
+	// Compact publication : a handful of definitions and one message per channel group, for slow links
+    IUFillSwitch(&PublicationS[0], "PUBLICATION_FULL", "Per channel", ISS_ON);
+    IUFillSwitch(&PublicationS[1], "PUBLICATION_COMPACT", "Compact", ISS_OFF);
+    IUFillSwitchVector(&PublicationSP, PublicationS, 2, getDeviceName(), "PUBLICATION", "Publication", "Options",
+                       IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+	// Configuration and diagnostic tabs are not needed at each connection : shown on request
+    IUFillSwitch(&TabsS[0], "CONFIGURATION", "Configuration", ISS_ON);
+    IUFillSwitch(&TabsS[1], "DIAGNOSTICS", "Diagnostics", ISS_OFF);
+    IUFillSwitchVector(&TabsSP, TabsS, 2, getDeviceName(), "SHOWN_TABS", "Show Tabs", "Options",
+                       IP_RW, ISR_NOFMANY, 0, IPS_IDLE);
 
-    ///////////////////////////////////////////////
-    //Page de presentation de l'état des relais
-	///////////////////////////////////////////////
-    //char name[3] = 'yyy', nameM[3] = 'xxx';
-	const char *name = "";
-	const char *nameM = "";
-	
-    for(int i=0;i<2;i++)
-    {
-        if (i ==0) {
-            name = "On";
-            nameM = "ON"; }
-        else if (i ==1) {
-            name = "Off";
-            nameM = "OFF";
-        }
-		else {
-			LOG_ERROR ("Initialization Error...");
-			return false;
-		}
-        IUFillSwitch(&Relay1StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Relay2StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Relay3StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Relay4StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Relay5StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Relay6StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Relay7StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Relay8StateS[i], name, nameM, ISS_OFF);
-    }
-    IUFillSwitchVector(&RelaysStatesSP[0], Relay1StateS, 2, getDeviceName(), "RELAY_1_STATE", "Relay 1", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaysStatesSP[1], Relay2StateS, 2, getDeviceName(), "RELAY_2_STATE", "Relay 2", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaysStatesSP[2], Relay3StateS, 2, getDeviceName(), "RELAY_3_STATE", "Relay 3", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaysStatesSP[3], Relay4StateS, 2, getDeviceName(), "RELAY_4_STATE", "Relay 4", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaysStatesSP[4], Relay5StateS, 2, getDeviceName(), "RELAY_5_STATE", "Relay 5", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaysStatesSP[5], Relay6StateS, 2, getDeviceName(), "RELAY_6_STATE", "Relay 6", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaysStatesSP[6], Relay7StateS, 2, getDeviceName(), "RELAY_7_STATE", "Relay 7", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&RelaysStatesSP[7], Relay8StateS, 2, getDeviceName(), "RELAY_8_STATE", "Relay 8", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-					 
-    //////////////////////////////////////////////////////////
-    //page de presentation de l'état des entrées discretes
-	//////////////////////////////////////////////////////////
-	
-    for(int i=0;i<2;i++)
-    {
-        if (i ==0) {
-            name = "On";
-            nameM = "ON"; }
-        else if (i ==1) {
-            name = "Off";
-            nameM = "OFF";
-        }
-		else {
-			LOG_ERROR ("Initialization Error...");
-			return false;
-		}
-        IUFillSwitch(&Digit1StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Digit2StateS[i], name, nameM,ISS_OFF);
-        IUFillSwitch(&Digit3StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Digit4StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Digit5StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Digit6StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Digit7StateS[i], name, nameM, ISS_OFF);
-        IUFillSwitch(&Digit8StateS[i], name, nameM,ISS_OFF);
-    }
-    IUFillSwitchVector(&DigitsStatesSP[0], Digit1StateS, 2, getDeviceName(), "DIGIT_1_STATE", "Digital 1", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitsStatesSP[1], Digit2StateS, 2, getDeviceName(), "DIGIT_2_STATE", "Digital 2", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitsStatesSP[2], Digit3StateS, 2, getDeviceName(), "DIGIT_3_STATE", "Digital 3", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitsStatesSP[3], Digit4StateS, 2, getDeviceName(), "DIGIT_4_STATE", "Digital 4", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitsStatesSP[4], Digit5StateS, 2, getDeviceName(), "DIGIT_5_STATE", "Digital 5", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitsStatesSP[5], Digit6StateS, 2, getDeviceName(), "DIGIT_6_STATE", "Digital 6", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitsStatesSP[6], Digit7StateS, 2, getDeviceName(), "DIGIT_7_STATE", "Digital 7", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-    IUFillSwitchVector(&DigitsStatesSP[7], Digit8StateS, 2, getDeviceName(), "DIGIT_8_STATE", "Digital 8", RAW_DATA_TAB,
-                     IP_RO,ISR_1OFMANY, 60, IPS_IDLE);
-	
 	// Initialisation des commutateurs ON/OFF
     IUFillSwitch(&roofEnginePowerS[0], "POWER_ON", "On", ISS_OFF);  // Par défaut sur OFF
     IUFillSwitch(&roofEnginePowerS[1], "POWER_OFF", "Off", ISS_ON); // Par défaut sur ON
@@ -305,9 +384,149 @@ bool Ipx800::initProperties()
                            ISR_1OFMANY,               // Comportement exclusif (radio buttons)
                            0,                         // Timeout (si nécessaire, mettre 0 pour ignorer)
                            IPS_IDLE);                 // État initial (inactif)
-	
-	    // Ajouter la propriété à l'onglet OPTIONS_TAB
-    defineProperty(&roofEnginePowerSP);	
+
+	// Roof travel timeout : engine power is cut when exceeded
+    IUFillNumber(&RoofTimeoutN[0], "ROOF_TIMEOUT_VALUE", "Timeout (s)", "%.0f", 5, 600, 1, DEFAULT_ROOF_TIMEOUT);
+    IUFillNumberVector(&RoofTimeoutNP, RoofTimeoutN, 1, getDeviceName(), "ROOF_TIMEOUT", "Roof Travel Timeout", "Options",
+                       IP_RW, 0, IPS_IDLE);
+	MotionRequest = RoofTimeoutN[0].value;
+
+	// Roof supervision, defined once connected
+    IUFillLight(&RoofStatusL[0], "ROOF_OPENED", "Opened", IPS_IDLE);
+    IUFillLight(&RoofStatusL[1], "ROOF_CLOSED", "Closed", IPS_IDLE);
+    IUFillLight(&RoofStatusL[2], "ROOF_MOVING", "Moving", IPS_IDLE);
+    IUFillLight(&RoofStatusL[3], "ROOF_FAULT", "Fault", IPS_IDLE);
+    IUFillLightVector(&RoofStatusLP, RoofStatusL, 4, getDeviceName(), "ROOF_STATUS", "Roof Status", ROLLOFF_TAB, IPS_IDLE);
+
+    IUFillNumber(&RoofTimeLeftN[0], "ROOF_TIME_LEFT_VALUE", "Time left (s)", "%.1f", 0, 600, 0, 0);
+    IUFillNumberVector(&RoofTimeLeftNP, RoofTimeLeftN, 1, getDeviceName(), "ROOF_TIME_LEFT", "Roof Motion", ROLLOFF_TAB,
+                       IP_RO, 0, IPS_IDLE);
+
+	// Roof runs durations, and the alert on a run slower than learned
+    IUFillNumber(&RoofRunAlertN[0], "PERCENTILE", "Percentile", "%.1f", 50, 100, 1, 95);
+    IUFillNumber(&RoofRunAlertN[1], "LEARNING_RUNS", "Learning Runs", "%.0f", 3, RoofRuns::RUNS, 1, 10);
+    IUFillNumberVector(&RoofRunAlertNP, RoofRunAlertN, 2, getDeviceName(), "ROOF_RUN_ALERT", "Slow Roof Alert", "Options",
+                       IP_RW, 0, IPS_IDLE);
+    IUFillNumber(&RoofRunsN[0], "OPEN_LAST", "Last Opening (s)", "%.1f", 0, 600, 0, 0);
+    IUFillNumber(&RoofRunsN[1], "OPEN_PERCENTILE", "Opening Percentile (s)", "%.1f", 0, 600, 0, 0);
+    IUFillNumber(&RoofRunsN[2], "OPEN_TREND", "Opening Trend (s / 10 runs)", "%.2f", -600, 600, 0, 0);
+    IUFillNumber(&RoofRunsN[3], "CLOSE_LAST", "Last Closing (s)", "%.1f", 0, 600, 0, 0);
+    IUFillNumber(&RoofRunsN[4], "CLOSE_PERCENTILE", "Closing Percentile (s)", "%.1f", 0, 600, 0, 0);
+    IUFillNumber(&RoofRunsN[5], "CLOSE_TREND", "Closing Trend (s / 10 runs)", "%.2f", -600, 600, 0, 0);
+    IUFillNumberVector(&RoofRunsNP, RoofRunsN, RoofRuns::DIRECTIONS * 3, getDeviceName(), "ROOF_RUNS", "Roof Runs", ROLLOFF_TAB,
+                       IP_RO, 0, IPS_IDLE);
+
+	// Dome (roll-off) interface : replaces the "Universal ROR" driver when enabled
+    IUFillSwitch(&DomeInterfaceS[0], "DOME_INTERFACE_ENABLE", "Enable", ISS_OFF);
+    IUFillSwitch(&DomeInterfaceS[1], "DOME_INTERFACE_DISABLE", "Disable", ISS_ON);
+    IUFillSwitchVector(&DomeInterfaceSP, DomeInterfaceS, 2, getDeviceName(), "DOME_INTERFACE", "Dome Interface", "Options",
+                       IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+	// M2M capture, not saved : to be started when needed
+    IUFillSwitch(&M2MCaptureS[0], "M2M_CAPTURE_START", "Start", ISS_OFF);
+    IUFillSwitch(&M2MCaptureS[1], "M2M_CAPTURE_STOP", "Stop", ISS_ON);
+    IUFillSwitchVector(&M2MCaptureSP, M2MCaptureS, 2, getDeviceName(), "M2M_CAPTURE", "M2M Capture", "Options",
+                       IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    IUFillSwitch(&DomeMotionS[0], "DOME_CW", "Open", ISS_OFF);
+    IUFillSwitch(&DomeMotionS[1], "DOME_CCW", "Close", ISS_OFF);
+    IUFillSwitchVector(&DomeMotionSP, DomeMotionS, 2, getDeviceName(), "DOME_MOTION", "Motion", ROLLOFF_TAB,
+                       IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+    IUFillSwitch(&DomeParkS[0], "PARK", "Park(ed)", ISS_OFF);
+    IUFillSwitch(&DomeParkS[1], "UNPARK", "UnPark(ed)", ISS_OFF);
+    IUFillSwitchVector(&DomeParkSP, DomeParkS, 2, getDeviceName(), "DOME_PARK", "Parking", ROLLOFF_TAB,
+                       IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    IUFillSwitch(&DomeAbortS[0], "ABORT", "Abort", ISS_OFF);
+    IUFillSwitchVector(&DomeAbortSP, DomeAbortS, 1, getDeviceName(), "DOME_ABORT_MOTION", "Abort Motion", ROLLOFF_TAB,
+                       IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+	updateDomeInterface();
+
+	// Relay timers, accurate to the ms and independent of clients
+    IUFillNumber(&RelayPulseN[0], "RELAY", "Relay", "%.0f", 1, relayCount, 1, 1);
+    IUFillNumber(&RelayPulseN[1], "DURATION", "Duration (ms)", "%.0f", 1, 3600000, 100, 500);
+    IUFillNumberVector(&RelayPulseNP, RelayPulseN, 2, getDeviceName(), "RELAY_PULSE", "Pulse", RELAY_TIMERS_TAB,
+                       IP_RW, 0, IPS_IDLE);
+    IUFillNumber(&RelayDelayN[0], "RELAY", "Relay", "%.0f", 1, relayCount, 1, 1);
+    IUFillNumber(&RelayDelayN[1], "DELAY", "Delay (ms)", "%.0f", 0, 3600000, 100, 1000);
+    IUFillNumber(&RelayDelayN[2], "STATE", "State (0/1)", "%.0f", 0, 1, 1, 1);
+    IUFillNumberVector(&RelayDelayNP, RelayDelayN, 3, getDeviceName(), "RELAY_DELAYED_SET", "Delayed Set", RELAY_TIMERS_TAB,
+                       IP_RW, 0, IPS_IDLE);
+
+	// Power sequencing, ex : "MOUNT_POWER_SUPPLY@2000; CAM_POWER_SUPPLY@1500 after MOUNT_POWER_SUPPLY; TUBE_VENTILATION"
+    IUFillText(&PowerSequenceT[0], "SEQUENCE", "Steps", "");
+    IUFillTextVector(&PowerSequenceTP, PowerSequenceT, 1, getDeviceName(), "POWER_SEQUENCE", "Sequence", POWER_SEQUENCE_TAB,
+                     IP_RW, 0, IPS_IDLE);
+    IUFillSwitch(&PowerSequenceS[0], "STARTUP", "Startup", ISS_OFF);
+    IUFillSwitch(&PowerSequenceS[1], "SHUTDOWN", "Shutdown", ISS_OFF);
+    IUFillSwitch(&PowerSequenceS[2], "ABORT", "Abort", ISS_OFF);
+    IUFillSwitchVector(&PowerSequenceSP, PowerSequenceS, 3, getDeviceName(), "POWER_SEQUENCE_CONTROL", "Run", POWER_SEQUENCE_TAB,
+                       IP_RW, ISR_ATMOST1, 0, IPS_IDLE);
+
+	// Weather safety snoop : roof closed by this driver when weather property is in Alert
+    IUFillText(&WeatherSnoopT[0], "DEVICE", "Weather Device", "");
+    IUFillText(&WeatherSnoopT[1], "PROPERTY", "Safety Property", "WEATHER_STATUS");
+    IUFillTextVector(&WeatherSnoopTP, WeatherSnoopT, 2, getDeviceName(), "WEATHER_SNOOP", "Weather Snoop", "Options",
+                     IP_RW, 0, IPS_IDLE);
+    IUFillSwitch(&WeatherCloseS[0], "WEATHER_CLOSE_ENABLE", "Enable", ISS_OFF);
+    IUFillSwitch(&WeatherCloseS[1], "WEATHER_CLOSE_DISABLE", "Disable", ISS_ON);
+    IUFillSwitchVector(&WeatherCloseSP, WeatherCloseS, 2, getDeviceName(), "WEATHER_CLOSE", "Close Roof on Alert", "Options",
+                       IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+	// Dew heater, from the standard weather parameters of the snooped device
+    IUFillText(&DewSnoopT[0], "DEVICE", "Weather Device", "");
+    IUFillText(&DewSnoopT[1], "PROPERTY", "Property", "WEATHER_PARAMETERS");
+    IUFillText(&DewSnoopT[2], "TEMPERATURE", "Temperature", "WEATHER_TEMPERATURE");
+    IUFillText(&DewSnoopT[3], "HUMIDITY", "Humidity", "WEATHER_HUMIDITY");
+    IUFillTextVector(&DewSnoopTP, DewSnoopT, 4, getDeviceName(), "DEW_SNOOP", "Weather Snoop", DEW_HEATER_TAB,
+                     IP_RW, 0, IPS_IDLE);
+    IUFillSwitch(&DewHeaterS[0], "DEW_HEATER_ENABLE", "Enable", ISS_OFF);
+    IUFillSwitch(&DewHeaterS[1], "DEW_HEATER_DISABLE", "Disable", ISS_ON);
+    IUFillSwitchVector(&DewHeaterSP, DewHeaterS, 2, getDeviceName(), "DEW_HEATER", "Dew Heater", DEW_HEATER_TAB,
+                       IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+    IUFillNumber(&DewSettingsN[DEW_FULL_MARGIN], "FULL_MARGIN", "Full power below (°C)", "%.1f", 0, 20, 0.5, 1);
+    IUFillNumber(&DewSettingsN[DEW_OFF_MARGIN], "OFF_MARGIN", "Off above (°C)", "%.1f", 0, 30, 0.5, 5);
+    IUFillNumber(&DewSettingsN[DEW_PERIOD], "PERIOD", "PWM Period (s)", "%.0f", 60, 3600, 60, 300);
+    IUFillNumber(&DewSettingsN[DEW_MIN_PULSE], "MIN_PULSE", "Min Pulse (s)", "%.0f", 0, 600, 10, 30);
+    IUFillNumber(&DewSettingsN[DEW_MAX_COMMANDS], "MAX_COMMANDS", "Max Commands / min", "%.0f", 1, 60, 1, 4);
+    IUFillNumberVector(&DewSettingsNP, DewSettingsN, 5, getDeviceName(), "DEW_SETTINGS", "Settings", DEW_HEATER_TAB,
+                       IP_RW, 0, IPS_IDLE);
+    IUFillNumber(&DewStatusN[DEW_TEMPERATURE], "TEMPERATURE", "Temperature (°C)", "%.1f", -100, 100, 0, 0);
+    IUFillNumber(&DewStatusN[DEW_HUMIDITY], "HUMIDITY", "Humidity (%)", "%.0f", 0, 100, 0, 0);
+    IUFillNumber(&DewStatusN[DEW_POINT], "DEW_POINT", "Dew Point (°C)", "%.1f", -100, 100, 0, 0);
+    IUFillNumber(&DewStatusN[DEW_MARGIN], "MARGIN", "Margin (°C)", "%.1f", -100, 100, 0, 0);
+    IUFillNumber(&DewStatusN[DEW_POWER], "POWER", "Power (%)", "%.0f", 0, 100, 0, 0);
+    IUFillNumberVector(&DewStatusNP, DewStatusN, 5, getDeviceName(), "DEW_STATUS", "Status", DEW_HEATER_TAB,
+                       IP_RO, 0, IPS_IDLE);
+
+	// Client updates rate limit, per group of properties
+    IUFillNumber(&UpdateIntervalN[0], "ANALOG", "Analog Inputs", "%.0f", 0, 3600000, 100, 0);
+    IUFillNumber(&UpdateIntervalN[1], "ANALOG_STATS", "Analog Statistics", "%.0f", 0, 3600000, 100, 0);
+    IUFillNumber(&UpdateIntervalN[2], "COUNTERS", "Counters", "%.0f", 0, 3600000, 100, 0);
+    IUFillNumber(&UpdateIntervalN[3], "ROOF_MOTION", "Roof Time Left", "%.0f", 0, 3600000, 100, 0);
+    IUFillNumberVector(&UpdateIntervalNP, UpdateIntervalN, 4, getDeviceName(), "UPDATE_INTERVAL",
+                       "Client Updates (ms, 0 = each poll)", "Options", IP_RW, 0, IPS_IDLE);
+
+    if (relayTimers.open())
+        relayTimersCallbackID = IEAddCallback(relayTimers.fd(), relayTimersHelper, this);
+    else
+        LOGF_ERROR("Relay timers unavailable : %s", strerror(errno));
+
+	// Mount park status, deduced from DEC/RA axis parked inputs
+    IUFillNumber(&MountDebounceN[0], "MOUNT_DEBOUNCE_VALUE", "Debounce (ms)", "%.0f", 0, 60000, 100, DEFAULT_MOUNT_DEBOUNCE);
+    IUFillNumberVector(&MountDebounceNP, MountDebounceN, 1, getDeviceName(), "MOUNT_PARK_DEBOUNCE", "Mount Park Debounce", "Options",
+                       IP_RW, 0, IPS_IDLE);
+
+    IUFillSwitch(&MountParkS[RA_PARKED], "RA_PARKED", "RA Parked", ISS_OFF);
+    IUFillSwitch(&MountParkS[DEC_PARKED], "DEC_PARKED", "DEC Parked", ISS_OFF);
+    IUFillSwitch(&MountParkS[BOTH_PARKED], "BOTH_PARKED", "Both Parked", ISS_OFF);
+    IUFillSwitch(&MountParkS[NONE_PARKED], "NONE_PARKED", "None Parked", ISS_ON);
+    IUFillSwitchVector(&MountParkSP, MountParkS, 4, getDeviceName(), "MOUNT_PARK_STATUS", "Mount Park", ROLLOFF_TAB,
+                       IP_RO, ISR_1OFMANY, 0, IPS_IDLE);
+
+	// Interlock rules, ex : "ROOF_CONTROL_COMMAND requires BOTH_PARKED; CAM_POWER_SUPPLY=OFF requires HEATING_RESISTOR_1=OFF"
+    IUFillText(&InterlockRulesT[0], "RULES", "Rules", "");
+    IUFillTextVector(&InterlockRulesTP, InterlockRulesT, 1, getDeviceName(), "INTERLOCK_RULES", "Interlocks", "Options",
+                     IP_RW, 0, IPS_IDLE);
 	
 	// Initialisation des commutateurs ON/OFF
     IUFillSwitch(&IPXVersionS[0], "VERSION_3", "V3", ISS_OFF);  // Par défaut sur OFF
@@ -323,9 +542,31 @@ bool Ipx800::initProperties()
                            ISR_1OFMANY,               // Comportement exclusif (radio buttons)
                            0,                         // Timeout (si nécessaire, mettre 0 pour ignorer)
                            IPS_IDLE);                 // État initial (inactif)
-
-    // Ajouter la propriété à l'onglet OPTIONS_TAB
-    defineProperty(&IPXVersionSP);
+	
+	// Options Tab defined in one batch, configuration and diagnostic tabs when shown
+    defineProperty(&ChannelLimitNP);
+    defineProperty(&PublicationSP);
+    defineProperty(&TabsSP);
+    defineProperty(&roofEnginePowerSP);
+    defineProperty(&RoofTimeoutNP);
+    defineProperty(&RoofRunAlertNP);
+    defineProperty(&DomeInterfaceSP);
+    defineProperty(&MountDebounceNP);
+    defineProperty(&InterlockRulesTP);
+    defineProperty(&WeatherSnoopTP);
+    defineProperty(&WeatherCloseSP);
+    defineProperty(&UpdateIntervalNP);
+    defineProperty(&RelayAutoOffNP);
+    defineProperty(&RelayWattsNP);
+    defineProperty(&DewSnoopTP);
+    defineProperty(&DewHeaterSP);
+    defineProperty(&DewSettingsNP);
+    defineProperty(&PowerSequenceTP);
+    defineTabs(shownTabs);
+	
+	if (stateSnapshot.hasState())
+		applySnapshot();
+	registerConfigItems();
 	
 	setDefaultPollingPeriod(DEFAULT_POLLING_TIMER);
 	
@@ -349,40 +590,108 @@ bool Ipx800::initProperties()
 
 bool Ipx800::Handshake()
 {
-	bool status = false;
-	bool res = false;
     if (isSimulation())
     {
         LOGF_INFO("Connected successfuly to simulated %s.", getDeviceName());
         return true;
     }
-	else {
-		res = readCommand(GetR);
-		readAnswer();
-		if (res==false) {
-			LOG_ERROR("Handshake with IPX800 failed");
-			return false;
-		}
-		else {
-			LOG_INFO("Handshake with IPX800 successfull");
-			return true;
-		}
-		readAnswer();
-		if (!checkAnswer())
-		{
-				LOG_ERROR("Handshake with IPX800 failed - Wrong answer");
-				res = false;
-		}
-		else {
-				recordData(GetR); 
-		}
-	}		
-    return status;
+	m2mCapture.record(M2MCapture::CAP_OPEN);
+	
+	// IPX800 generation : as found last time for this host, otherwise probed
+	const char *home = getenv("HOME");
+	std::string cachePath = std::string(home ? home : ".") + "/.indi/" + getDeviceName() + "_versions.txt";
+	std::string hostKey = std::string(tcpConnection->host()) + ":" + std::to_string(tcpConnection->port());
+	int version = cachedVersion(cachePath.c_str(), hostKey);
+	if (version >= 0 && startProtocol(version))
+	{
+		LOGF_INFO("Handshake with IPX800 V%d successfull", version);
+		return true;
+	}
+	if (version >= 0)
+		LOGF_WARN("IPX800 at %s doesn't answer as V%d anymore, probing", hostKey.c_str(), version);
+	
+	// all generations probed at once, the first valid answer wins
+	ProbeRequest requests[PROTOCOLS];
+	for (int i=0;i<PROTOCOLS;i++)
+		requests[i] = protocols[i].probe;
+	uint64_t probeStart = monotonicMs();
+	std::string probeAnswer;
+	int found = probeFirst(tcpConnection->host(), tcpConnection->port(), requests, PROTOCOLS, PROBE_TIMEOUT, &probeAnswer);
+	if (found < 0) {
+		LOGF_ERROR("Handshake with IPX800 failed - No known protocol answered at %s", hostKey.c_str());
+		cacheVersion(cachePath.c_str(), hostKey, -1);
+		return false;
+	}
+	// the winning probe is captured too, ipx800_replay answers it on its own connection
+	m2mCapture.record(M2MCapture::CAP_PROBE_TX, requests[found].request, strlen(requests[found].request));
+	m2mCapture.record(M2MCapture::CAP_PROBE_RX, probeAnswer.data(), probeAnswer.size());
+	version = protocols[found].version;
+	LOGF_INFO("IPX800 V%d detected in %u ms", version, static_cast<unsigned>(monotonicMs() - probeStart));
+	if (!startProtocol(version)) {
+		LOG_ERROR("Handshake with IPX800 failed - Wrong answer");
+		return false;
+	}
+	if (!cacheVersion(cachePath.c_str(), hostKey, version))
+		LOGF_WARN("IPX800 version can't be saved in %s", cachePath.c_str());
+	LOGF_INFO("Handshake with IPX800 V%d successfull", version);
+	return true;
+}
+
+//////////////////////////////////////
+/* startProtocol */
+// Selects the commands of an IPX800 generation, and counts channels from its validated answers
+bool Ipx800::startProtocol(int version)
+{
+	if (version < protocols[0].version || version >= protocols[0].version + PROTOCOLS)
+		return false;
+	protocol = &protocols[version - protocols[0].version];
+	IUResetSwitch(&IPXVersionSP);
+	IPXVersionS[version - protocols[0].version].s = ISS_ON;
+	IPXVersionSP.s = IPS_OK;
+	// defined once connected, with this value
+	if (isConnected())
+		IDSetSwitch(&IPXVersionSP, nullptr);
+	if (protocol->getRelays == nullptr) {
+		LOGF_ERROR("IPX800 V%d is not supported yet", version);
+		return false;
+	}
+	
+	// one character per relay / digital input, extensions included
+	if (!readCommand(GetR))
+		return false;
+	readAnswer();
+	int relays = static_cast<int>(strspn(rawAnswer, "01"));
+	if (relays == 0 || !checkAnswer(relays))
+		return false;
+	if (!readCommand(GetD))
+		return false;
+	readAnswer();
+	int digitals = static_cast<int>(strspn(rawAnswer, "01"));
+	if (digitals == 0 || !checkAnswer(digitals))
+		return false;
+	
+	setChannelCounts(relays, digitals);
+	// weather close commands are written in this generation's syntax
+	prepareWeatherClose();
+	return true;
 }
 
 void Ipx800::ISGetProperties(const char *dev)
 {
     INDI::DefaultDevice::ISGetProperties(dev);
+	
+	// once configuration is loaded (publication mode), the last known state is shown until connection
+	if (snapshotPending && !isConnected()) {
+		snapshotPending = false;
+		staleState = true;
+		defineChannelProperties(false, true);
+		defineProperty(&RoofStatusLP);
+		defineProperty(&MountParkSP);
+		time_t savedAt = static_cast<time_t>(stateSnapshot.state().savedAt);
+		char date[32];
+		strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&savedAt));
+		LOGF_INFO("Last known state, from %s, shown until confirmed by IPX800", date);
+	}
 
 }
 
@@ -393,6 +702,44 @@ void ISSnoopDevice(XMLEle *root)
 
 bool Ipx800::ISSnoopDevice(XMLEle *root)
 {
+    const char *devName = findXMLAttValu(root, "device");
+    const char *propName = findXMLAttValu(root, "name");
+    
+    // Weather safety property : roof closed directly on Alert
+    if (weatherClose && !strcmp(devName, WeatherSnoopT[0].text) && !strcmp(propName, WeatherSnoopT[1].text))
+    {
+        const char *state = findXMLAttValu(root, "state");
+        if (!strcmp(state, "Alert")) {
+            if (!weatherAlert)
+                LOGF_WARN("Weather alert from %s, closing roof", devName);
+            weatherAlert = true;
+            weatherCloseRoof();
+        }
+        else if (state[0] != '\0' && weatherAlert) {
+            LOGF_INFO("Weather alert from %s cleared", devName);
+            weatherAlert = false;
+            weatherCloseIssued = false;
+        }
+    }
+    
+    // Ambient temperature and humidity for the dew heater
+    if (!strcmp(devName, DewSnoopT[0].text) && !strcmp(propName, DewSnoopT[1].text))
+    {
+        bool updated = false;
+        for (XMLEle *ep = nextXMLEle(root, 1); ep != nullptr; ep = nextXMLEle(root, 0)) {
+            const char *element = findXMLAttValu(ep, "name");
+            if (!strcmp(element, DewSnoopT[2].text))
+                dewTemperature = atof(pcdataXMLEle(ep));
+            else if (!strcmp(element, DewSnoopT[3].text))
+                dewHumidity = atof(pcdataXMLEle(ep));
+            else
+                continue;
+            updated = true;
+        }
+        if (updated)
+            updateDewPoint();
+    }
+    
     return INDI::DefaultDevice::ISSnoopDevice(root);
 }
 
@@ -403,6 +750,7 @@ bool Ipx800::setupParams()
 {	
     LOG_DEBUG("Setting Params...");
     updateObsStatus(); 
+    prepareWeatherClose();
 
 
     return true;
@@ -415,6 +763,7 @@ void ISNewSwitch(const char *dev, const char *name, ISState *states, char *names
 
 bool Ipx800::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
 {
+    noteConfigChange(dev, name);
     ISwitch *myRelaisInfoS;
     ISwitchVectorProperty myRelaisInfoSP;
 
@@ -466,33 +815,187 @@ bool Ipx800::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
             IDSetSwitch(&roofEnginePowerSP, nullptr);
         }
 		
-		for(int i=0;i<8;i++)
+		// Power sequence Startup / Shutdown / Abort
+        if (strcmp(name, PowerSequenceSP.name) == 0)
+        {
+            IUUpdateSwitch(&PowerSequenceSP, states, names, n);
+            int selected = IUFindOnSwitchIndex(&PowerSequenceSP);
+            if (selected == 2 || selected < 0)
+                stopPowerSequence(IPS_IDLE, "Power sequence aborted");
+            else
+                startPowerSequence(selected == 0 ? POWER_STARTUP : POWER_SHUTDOWN);
+            return true;
+        }
+		
+		// Roof closing on weather alert - Options Tab
+        if (strcmp(name, WeatherCloseSP.name) == 0)
+        {
+            IUUpdateSwitch(&WeatherCloseSP, states, names, n);
+            weatherClose = (WeatherCloseS[0].s == ISS_ON);
+            prepareWeatherClose();
+            WeatherCloseSP.s = IPS_OK;
+            IDSetSwitch(&WeatherCloseSP, nullptr);
+            return true;
+        }
+		
+		// Dew heater - Dew Heater Tab
+        if (strcmp(name, DewHeaterSP.name) == 0)
+        {
+            IUUpdateSwitch(&DewHeaterSP, states, names, n);
+            bool enable = (DewHeaterS[0].s == ISS_ON);
+            if (dewHeater && !enable)
+                stopDewHeater();
+            dewHeater = enable;
+            dewPeriodStart = 0;
+            DewHeaterSP.s = IPS_OK;
+            IDSetSwitch(&DewHeaterSP, nullptr);
+            return true;
+        }
+		
+		// M2M capture start / stop - Options Tab
+        if (strcmp(name, M2MCaptureSP.name) == 0)
+        {
+            IUUpdateSwitch(&M2MCaptureSP, states, names, n);
+            if (M2MCaptureS[0].s == ISS_ON && !m2mCapture.isOpen()) {
+                char stamp[32];
+                time_t now = time(nullptr);
+                strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+                const char *home = getenv("HOME");
+                std::string path = std::string(home ? home : ".") + "/.indi/" + getDeviceName() + "_m2m_" + stamp + ".cap";
+                if (m2mCapture.open(path.c_str())) {
+                    if (isConnected())
+                        m2mCapture.record(M2MCapture::CAP_OPEN);
+                    LOGF_INFO("M2M capture started in %s", path.c_str());
+                    M2MCaptureSP.s = IPS_BUSY;
+                }
+                else {
+                    LOGF_ERROR("M2M capture : can't create %s", path.c_str());
+                    IUResetSwitch(&M2MCaptureSP);
+                    M2MCaptureS[1].s = ISS_ON;
+                    M2MCaptureSP.s = IPS_ALERT;
+                }
+            }
+            else if (M2MCaptureS[1].s == ISS_ON && m2mCapture.isOpen()) {
+                m2mCapture.close();
+                LOG_INFO("M2M capture stopped");
+                M2MCaptureSP.s = IPS_IDLE;
+            }
+            IDSetSwitch(&M2MCaptureSP, nullptr);
+            return true;
+        }
+		
+		// Shown tabs - Options Tab
+        if (strcmp(name, TabsSP.name) == 0)
+        {
+            IUUpdateSwitch(&TabsSP, states, names, n);
+            int tabs = (TabsS[0].s == ISS_ON ? CONFIGURATION_TABS : 0) | (TabsS[1].s == ISS_ON ? DIAGNOSTIC_TABS : 0);
+            TabsSP.s = IPS_OK;
+            IDSetSwitch(&TabsSP, nullptr);
+            deleteTabs(shownTabs & ~tabs);
+            int added = tabs & ~shownTabs;
+            shownTabs = tabs;
+            defineTabs(added);
+            return true;
+        }
+		
+		// Publication mode - Options Tab
+        if (strcmp(name, PublicationSP.name) == 0)
+        {
+            IUUpdateSwitch(&PublicationSP, states, names, n);
+            bool compact = (PublicationS[1].s == ISS_ON);
+            PublicationSP.s = IPS_OK;
+            IDSetSwitch(&PublicationSP, nullptr);
+            if (compact != compactPublication) {
+                // element values are kept up to date in both modes : the new vectors are defined with current states
+                bool configuration = (shownTabs & CONFIGURATION_TABS) != 0;
+                deleteChannelProperties(configuration, isConnected() || staleState);
+                compactPublication = compact;
+                defineChannelProperties(configuration, isConnected() || staleState);
+                LOGF_INFO("%s publication", compact ? "Compact" : "Per channel");
+            }
+            return true;
+        }
+		
+		// Dome Interface activation - Options Tab
+        if (strcmp(name, DomeInterfaceSP.name) == 0)
+        {
+            IUUpdateSwitch(&DomeInterfaceSP, states, names, n);
+            bool enable = (DomeInterfaceS[0].s == ISS_ON);
+            DomeInterfaceSP.s = IPS_OK;
+            IDSetSwitch(&DomeInterfaceSP, nullptr);
+            if (enable != domeInterface) {
+                if (isConnected() && !enable) {
+                    deleteProperty(DomeMotionSP.name);
+                    deleteProperty(DomeParkSP.name);
+                    deleteProperty(DomeAbortSP.name);
+                }
+                domeInterface = enable;
+                updateDomeInterface();
+                if (isConnected() && enable) {
+                    defineProperty(&DomeMotionSP);
+                    defineProperty(&DomeParkSP);
+                    defineProperty(&DomeAbortSP);
+                    publishRoofStatus();
+                }
+                LOGF_INFO("Dome interface %s", enable ? "enabled" : "disabled");
+            }
+            return true;
+        }
+		
+		// Dome motion : Open (CW) / Close (CCW)
+        if (domeInterface && strcmp(name, DomeMotionSP.name) == 0)
+        {
+            IUUpdateSwitch(&DomeMotionSP, states, names, n);
+            int roofTarget = (DomeMotionS[0].s == ISS_ON) ? ROOF_IS_OPENED : ROOF_IS_CLOSED;
+            DomeMotionSP.s = moveRoof(roofTarget) ? IPS_BUSY : IPS_ALERT;
+            IDSetSwitch(&DomeMotionSP, nullptr);
+            return true;
+        }
+		
+		// Dome parking : Park = roof closed, UnPark = roof opened
+        if (domeInterface && strcmp(name, DomeParkSP.name) == 0)
+        {
+            IUUpdateSwitch(&DomeParkSP, states, names, n);
+            int roofTarget = (DomeParkS[0].s == ISS_ON) ? ROOF_IS_CLOSED : ROOF_IS_OPENED;
+            DomeParkSP.s = moveRoof(roofTarget) ? IPS_BUSY : IPS_ALERT;
+            IDSetSwitch(&DomeParkSP, nullptr);
+            return true;
+        }
+		
+        if (domeInterface && strcmp(name, DomeAbortSP.name) == 0)
+        {
+            DomeAbortS[0].s = ISS_OFF;
+            DomeAbortSP.s = abortRoof() ? IPS_OK : IPS_ALERT;
+            IDSetSwitch(&DomeAbortSP, nullptr);
+            return true;
+        }
+		
+		for(int i=0;i<std::max(relayCount, digitalCount);i++)
 		{
-			myRelaisInfoSP = ipx800->getMyRelayVector(i);
-			myDigitalInputSP = ipx800->getMyDigitsVector(i);
-			
 			////////////////////////////////////////////////////
 			// Relay Configuration
 			////////////////////////////////////////////////////
 			
-			
-			if (!strcmp(name, myRelaisInfoSP.name))
+			if (i < relayCount && !strcmp(name, RelaisInfoSP[i].name))
 				{	
+					myRelaisInfoSP = ipx800->getMyRelayVector(i);
 					LOGF_DEBUG("Relay function selected - SP : %s", myRelaisInfoSP.name);
 					IUUpdateSwitch(&myRelaisInfoSP,states,names,n);
 					
 					myRelaisInfoS = myRelaisInfoSP.sp;
 					myRelaisInfoSP.s = IPS_OK;
-					IDSetSwitch(&myRelaisInfoSP,nullptr);
+					if (!compactPublication && (shownTabs & CONFIGURATION_TABS))
+						IDSetSwitch(&myRelaisInfoSP,nullptr);
+					syncChannelFunction(RELAY_CHANNELS, i);
 					
 					currentRIndex = IUFindOnSwitchIndex(&myRelaisInfoSP);
 					
 					if (currentRIndex != -1) {
-						Relay_Fonction_Tab [currentRIndex] = i;
+						assignFunction(RELAY_CHANNELS, i, currentRIndex);
+						prepareWeatherClose();
 						
 						LOGF_DEBUG("Relay fonction index : %d", currentRIndex);
-
-						defineProperty(&RelaysStatesSP[i]);}
+					}
 					else 
 						LOG_DEBUG("No On Switches found"); 
 					
@@ -503,22 +1006,23 @@ bool Ipx800::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
 			////////////////////////////////////////////////////
 			// Digits Configuration
 			////////////////////////////////////////////////////
-			if (!strcmp(name, myDigitalInputSP.name))
+			if (i < digitalCount && !strcmp(name, DigitalInputSP[i].name))
 				{ 
+				myDigitalInputSP = ipx800->getMyDigitsVector(i);
 				LOGF_DEBUG("Digital init : %s", myDigitalInputSP.name);
 				IUUpdateSwitch(&myDigitalInputSP,states,names,n);
 				
 				myDigitalInputS = myDigitalInputSP.sp;
 				// myRelaisInfoS[].s  = ISS_ON;
 				myDigitalInputSP.s = IPS_OK;
-				IDSetSwitch(&myDigitalInputSP,nullptr);
+				if (!compactPublication && (shownTabs & CONFIGURATION_TABS))
+					IDSetSwitch(&myDigitalInputSP,nullptr);
+				syncChannelFunction(DIGITAL_CHANNELS, i);
 				//sauvegarde de la configuration
 				currentDIndex = IUFindOnSwitchIndex(&myDigitalInputSP);
 				if (currentDIndex != -1) {
-					Digital_Fonction_Tab [currentDIndex] = i;
+					assignFunction(DIGITAL_CHANNELS, i, currentDIndex);
 					LOGF_DEBUG("Digital Inp. fonction index : %d", currentDIndex);
-					defineProperty(&DigitsStatesSP[i]);
-			
 				 }
 				else 
 					LOG_DEBUG("No On Switches found"); 
@@ -547,6 +1051,7 @@ void ISNewText(const char *dev, const char *name, char *texts[], char *names[],
 
 bool Ipx800::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
 {
+    noteConfigChange(dev, name);
     ////////////////////////////////////////////////////
     // IPX Access - If password protected
 	// To manage in a next release
@@ -566,6 +1071,87 @@ bool Ipx800::ISNewText(const char *dev, const char *name, char *texts[], char *n
 	 */
 	 
 	 
+	 if (dev != nullptr && strcmp(dev, getDeviceName()) == 0 && strcmp(name, InterlockRulesTP.name) == 0)
+	 {
+		 if (compileInterlockRules(texts[0])) {
+			 IUUpdateText(&InterlockRulesTP, texts, names, n);
+			 InterlockRulesTP.s = IPS_OK;
+			 IDSetText(&InterlockRulesTP, "%d interlock rule(s) loaded", static_cast<int>(interlockRules.size()));
+		 }
+		 else {
+			 InterlockRulesTP.s = IPS_ALERT;
+			 IDSetText(&InterlockRulesTP, "Interlock rules rejected, previous rules kept");
+		 }
+		 return true;
+	 }
+	 
+	 // Compact publication : functions of a whole channel group, by name ("ROOF_CONTROL_COMMAND", empty for unused)
+	 for (int kind=0; dev != nullptr && strcmp(dev, getDeviceName()) == 0 && kind<CHANNEL_KINDS; kind++)
+	 {
+		 if (strcmp(name, channelFunctionTP[kind].name) != 0)
+			 continue;
+		 const ChannelKind &k = channelKinds[kind];
+		 bool rejected = false;
+		 for (int j=0;j<n;j++) {
+			 IText *functionText = IUFindText(&channelFunctionTP[kind], names[j]);
+			 if (functionText == nullptr)
+				 continue;
+			 int channel = static_cast<int>(functionText - channelFunctionT[kind].data());
+			 std::string token = trimToken(texts[j]);
+			 int fonction = (token.empty() || strcasecmp(token.c_str(), k.functionNames[0]) == 0) ? 0
+			                : findFunction(k.functionNames, k.functions, token);
+			 if (fonction < 0) {
+				 LOGF_ERROR("%s : unknown function %s", functionText->label, token.c_str());
+				 rejected = true;
+				 continue;
+			 }
+			 // same path as a selection in the per channel vector
+			 ISState on = ISS_ON;
+			 char *functionName = channelConfigSP[kind][channel].sp[fonction].name;
+			 ISNewSwitch(dev, channelConfigSP[kind][channel].name, &on, &functionName, 1);
+		 }
+		 channelFunctionTP[kind].s = rejected ? IPS_ALERT : IPS_OK;
+		 IDSetText(&channelFunctionTP[kind], nullptr);
+		 return true;
+	 }
+	 
+	 if (dev != nullptr && strcmp(dev, getDeviceName()) == 0 && strcmp(name, WeatherSnoopTP.name) == 0)
+	 {
+		 IUUpdateText(&WeatherSnoopTP, texts, names, n);
+		 if (WeatherSnoopT[0].text[0] != '\0')
+			 IDSnoopDevice(WeatherSnoopT[0].text, WeatherSnoopT[1].text);
+		 weatherAlert = false;
+		 weatherCloseIssued = false;
+		 WeatherSnoopTP.s = IPS_OK;
+		 IDSetText(&WeatherSnoopTP, nullptr);
+		 return true;
+	 }
+	 
+	 if (dev != nullptr && strcmp(dev, getDeviceName()) == 0 && strcmp(name, DewSnoopTP.name) == 0)
+	 {
+		 IUUpdateText(&DewSnoopTP, texts, names, n);
+		 if (DewSnoopT[0].text[0] != '\0')
+			 IDSnoopDevice(DewSnoopT[0].text, DewSnoopT[1].text);
+		 dewDataAt = 0;
+		 DewSnoopTP.s = IPS_OK;
+		 IDSetText(&DewSnoopTP, nullptr);
+		 return true;
+	 }
+	 
+	 if (dev != nullptr && strcmp(dev, getDeviceName()) == 0 && strcmp(name, PowerSequenceTP.name) == 0)
+	 {
+		 if (powerSequence == POWER_IDLE && compilePowerSequence(texts[0])) {
+			 IUUpdateText(&PowerSequenceTP, texts, names, n);
+			 PowerSequenceTP.s = IPS_OK;
+			 IDSetText(&PowerSequenceTP, "%d power sequence step(s) loaded", static_cast<int>(powerSteps.size()));
+		 }
+		 else {
+			 PowerSequenceTP.s = IPS_ALERT;
+			 IDSetText(&PowerSequenceTP, "Power sequence rejected, previous sequence kept");
+		 }
+		 return true;
+	 }
+	 
 	 if (INDI::InputInterface::processText(dev, name, texts, names, n))
             return true;
      if (INDI::OutputInterface::processText(dev, name, texts, names, n))
@@ -581,8 +1167,120 @@ void ISNewNumber(const char *dev, const char *name, double values[], char *names
 
 bool Ipx800::ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n)
 {
+    noteConfigChange(dev, name);
     if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
-		return true;
+    {
+        if (strcmp(name, RoofTimeoutNP.name) == 0)
+        {
+            IUUpdateNumber(&RoofTimeoutNP, values, names, n);
+            MotionRequest = RoofTimeoutN[0].value;
+            RoofTimeoutNP.s = IPS_OK;
+            IDSetNumber(&RoofTimeoutNP, nullptr);
+            return true;
+        }
+        if (strcmp(name, RoofRunAlertNP.name) == 0)
+        {
+            IUUpdateNumber(&RoofRunAlertNP, values, names, n);
+            RoofRunAlertNP.s = IPS_OK;
+            IDSetNumber(&RoofRunAlertNP, nullptr);
+            publishRoofRuns(RoofRunsNP.s == IPS_ALERT);
+            return true;
+        }
+        if (strcmp(name, DigitalFilterSamplesNP.name) == 0)
+        {
+            IUUpdateNumber(&DigitalFilterSamplesNP, values, names, n);
+            DigitalFilterSamplesNP.s = IPS_OK;
+            IDSetNumber(&DigitalFilterSamplesNP, nullptr);
+            return true;
+        }
+        if (strcmp(name, DigitalFilterTimeNP.name) == 0)
+        {
+            IUUpdateNumber(&DigitalFilterTimeNP, values, names, n);
+            DigitalFilterTimeNP.s = IPS_OK;
+            IDSetNumber(&DigitalFilterTimeNP, nullptr);
+            return true;
+        }
+        if (strcmp(name, RelayPulseNP.name) == 0)
+        {
+            IUUpdateNumber(&RelayPulseNP, values, names, n);
+            RelayPulseNP.s = pulseRelay(RelayPulseN[0].value - 1, RelayPulseN[1].value) ? IPS_BUSY : IPS_ALERT;
+            IDSetNumber(&RelayPulseNP, nullptr);
+            return true;
+        }
+        if (strcmp(name, RelayDelayNP.name) == 0)
+        {
+            IUUpdateNumber(&RelayDelayNP, values, names, n);
+            OutputState command = RelayDelayN[2].value > 0 ? INDI::OutputInterface::On : INDI::OutputInterface::Off;
+            RelayDelayNP.s = delayRelay(RelayDelayN[0].value - 1, RelayDelayN[1].value, command) ? IPS_BUSY : IPS_ALERT;
+            IDSetNumber(&RelayDelayNP, nullptr);
+            return true;
+        }
+        if (strcmp(name, RelayAutoOffNP.name) == 0)
+        {
+            IUUpdateNumber(&RelayAutoOffNP, values, names, n);
+            RelayAutoOffNP.s = IPS_OK;
+            IDSetNumber(&RelayAutoOffNP, nullptr);
+            return true;
+        }
+        if (strcmp(name, DewSettingsNP.name) == 0)
+        {
+            IUUpdateNumber(&DewSettingsNP, values, names, n);
+            bool valid = DewSettingsN[DEW_FULL_MARGIN].value < DewSettingsN[DEW_OFF_MARGIN].value;
+            DewSettingsNP.s = valid ? IPS_OK : IPS_ALERT;
+            IDSetNumber(&DewSettingsNP, valid ? nullptr : "Full power margin must be below off margin");
+            if (dewDataAt != 0)
+                updateDewPoint();
+            return true;
+        }
+        if (strcmp(name, RelayWattsNP.name) == 0)
+        {
+            IUUpdateNumber(&RelayWattsNP, values, names, n);
+            RelayWattsNP.s = IPS_OK;
+            IDSetNumber(&RelayWattsNP, nullptr);
+            // energy shown with the new power at next poll
+            usagePublishedAt = 0;
+            return true;
+        }
+        if (strcmp(name, ChannelLimitNP.name) == 0)
+        {
+            IUUpdateNumber(&ChannelLimitNP, values, names, n);
+            ChannelLimitNP.s = IPS_OK;
+            IDSetNumber(&ChannelLimitNP, isConnected() ? "Channels limit applies at next connection" : nullptr);
+            return true;
+        }
+        if (strcmp(name, AnalogScaleNP.name) == 0)
+        {
+            IUUpdateNumber(&AnalogScaleNP, values, names, n);
+            // statistics are in scaled units : restart them
+            for (int i=0;i<ANALOG_INPUTS;i++)
+                analogWindow[i].clear();
+            analogPrimed = false;
+            AnalogScaleNP.s = IPS_OK;
+            IDSetNumber(&AnalogScaleNP, nullptr);
+            return true;
+        }
+        if (strcmp(name, AnalogDeadbandNP.name) == 0)
+        {
+            IUUpdateNumber(&AnalogDeadbandNP, values, names, n);
+            AnalogDeadbandNP.s = IPS_OK;
+            IDSetNumber(&AnalogDeadbandNP, nullptr);
+            return true;
+        }
+        if (strcmp(name, UpdateIntervalNP.name) == 0)
+        {
+            IUUpdateNumber(&UpdateIntervalNP, values, names, n);
+            UpdateIntervalNP.s = IPS_OK;
+            IDSetNumber(&UpdateIntervalNP, nullptr);
+            return true;
+        }
+        if (strcmp(name, MountDebounceNP.name) == 0)
+        {
+            IUUpdateNumber(&MountDebounceNP, values, names, n);
+            MountDebounceNP.s = IPS_OK;
+            IDSetNumber(&MountDebounceNP, nullptr);
+            return true;
+        }
+    }
 
     return INDI::DefaultDevice::ISNewNumber(dev, name, values, names, n);
 }
@@ -593,6 +1291,7 @@ bool Ipx800::ISNewNumber(const char *dev, const char *name, double values[], cha
 ///////////////////////////////////////////
 bool Ipx800::Connect()
 {
+	connectStartMs = monotonicMs();
 	bool status = INDI::DefaultDevice::Connect();
 	LOG_DEBUG("Connecting to device...");
 
@@ -602,6 +1301,10 @@ bool Ipx800::Connect()
 
 bool Ipx800::Disconnect()
 {
+    // heaters would stay as they are, without control
+    if (dewHeater)
+        stopDewHeater();
+    m2mCapture.record(M2MCapture::CAP_CLOSE);
     bool status = INDI::DefaultDevice::Disconnect();
 	
     return status;
@@ -623,39 +1326,95 @@ bool Ipx800::updateProperties()
 	///////////////////////////
     if (isConnected())
     { // Connect both states tabs 
+		// status properties already defined from the last known state are confirmed by this first poll
+		bool statesDefined = staleState;
+		staleState = false;
 		updateIPXData();
-		//firstFonctionTabInit();
 		//updateObsStatus();
 		INDI::InputInterface::updateProperties();
 		INDI::OutputInterface::updateProperties();
-		defineProperty(&roofEnginePowerSP);
 		defineProperty(&IPXVersionSP);
-        for(int i=0;i<8;i++)
-        {
-            defineProperty(&RelaysStatesSP[i]);
-			//MàJ DomeState
-        }
-        for(int i=0;i<8;i++)
-        {
-             defineProperty(&DigitsStatesSP[i]);
-        }
+		if (!statesDefined) {
+			defineProperty(&RoofStatusLP);
+			defineProperty(&MountParkSP);
+		}
+		defineProperty(&RoofTimeLeftNP);
+		defineProperty(&RoofRunsNP);
+		publishRoofRuns(false);
+		defineProperty(&RelayPulseNP);
+		defineProperty(&RelayDelayNP);
+		defineProperty(&PowerSequenceSP);
+		if (shownTabs & DIAGNOSTIC_TABS)
+			defineProperty(&AnalogStatsNP);
+		defineProperty(&CountersNP);
+		defineProperty(&RelayUsageNP);
+		defineProperty(&DewStatusNP);
+		if (domeInterface) {
+			defineProperty(&DomeMotionSP);
+			defineProperty(&DomeParkSP);
+			defineProperty(&DomeAbortSP);
+		}
+		if (!statesDefined)
+			defineChannelProperties(false, true);
 	
         setupParams(); 
+		PollTimerID = SetTimer(getPollingPeriod());
 
     }
     else { // Disconnect both "States TAB"
       
-		for(int i=0;i<8;i++)
-        {
-            deleteProperty(RelaysStatesSP[i].name);
-
-        }
-        for(int i=0;i<8;i++)
-        {
-             deleteProperty(DigitsStatesSP[i].name);
-        }
-		deleteProperty(roofEnginePowerSP.name);
+		deleteChannelProperties(false, true);
+		relayPublishedValid = false;
 		deleteProperty(IPXVersionSP.name);
+		deleteProperty(RoofStatusLP.name);
+		deleteProperty(RoofTimeLeftNP.name);
+		deleteProperty(RoofRunsNP.name);
+		roofRunStart = 0;
+		deleteProperty(MountParkSP.name);
+		MountParkSP.s = IPS_IDLE;
+		mountAccepted = false;
+		mountCandidateSince = 0;
+		deleteProperty(RelayPulseNP.name);
+		deleteProperty(RelayDelayNP.name);
+		deleteProperty(PowerSequenceSP.name);
+		if (shownTabs & DIAGNOSTIC_TABS)
+			deleteProperty(AnalogStatsNP.name);
+		for (int i=0;i<ANALOG_INPUTS;i++)
+			analogWindow[i].clear();
+		analogPrimed = false;
+		deleteProperty(CountersNP.name);
+		counterPrimed = false;
+		for (int i=0;i<COUNTERS;i++)
+			counterRate[i] = 0;
+		// relays state is unknown until next connection
+		deleteProperty(RelayUsageNP.name);
+		deleteProperty(DewStatusNP.name);
+		dewPeriodStart = 0;
+		relayUsage.suspend(realtimeMs());
+		relayUsage.save(realtimeMs());
+		usagePublishedAt = 0;
+		for (int i=0;i<COUNTERS*3;i++)
+			CountersN[i].value = 0;
+		// a pending configuration save is done now, other timers are dropped
+		if (configSaveID >= 0)
+			writeConfigFile();
+		configSaveID = -1;
+		// pending relay actions are meaningless once disconnected
+		stopPowerSequence(IPS_IDLE, nullptr);
+		relayTimers.clear();
+		weatherCloseIssued = false;
+		roofPulseTimerID = -1;
+		roofReverseTimerID = -1;
+		for (RateLimit &limit : rateLimits)
+			limit = RateLimit();
+		std::fill(relayAutoOffID.begin(), relayAutoOffID.end(), -1);
+		std::fill(relayPulseID.begin(), relayPulseID.end(), -1);
+		digitalFilterPrimed = false;
+		if (domeInterface) {
+			deleteProperty(DomeMotionSP.name);
+			deleteProperty(DomeParkSP.name);
+			deleteProperty(DomeAbortSP.name);
+		}
 
     }
     return true;
@@ -671,51 +1430,176 @@ void Ipx800::TimerHit()
         return; //  No need to reset timer if we are not connected anymore
 	}
 	
-	updateIPXData();
+	// dew heater commands follow the poll, on a fresh relays state
+	if (updateIPXData())
+		runDewHeater();
     
-    SetTimer(getPollingPeriod());
+	// Faster polling while the roof is moving : limit switches and timeout are checked on each snapshot
+	if (Roof_Motion != ROOF_STOPPED)
+		PollTimerID = SetTimer(std::min<uint32_t>(getPollingPeriod(), ROOF_MOTION_POLLING_TIMER));
+	else
+		PollTimerID = SetTimer(getPollingPeriod());
 }
 //////////////////////////////////////
 /* Save conf */
+// Cached serialization of each item, only items changed since the last save are written again
 bool Ipx800::saveConfigItems(FILE *fp)
 {
+	forEachConfigItem([this, fp](const char *name, const ConfigSaver &save) {
+		ConfigItem &item = configCache[name];
+		if (item.dirty) {
+			char *buffer = nullptr;
+			size_t size = 0;
+			FILE *memory = open_memstream(&buffer, &size);
+			if (memory == nullptr) {
+				save(fp);
+				return;
+			}
+			save(memory);
+			fclose(memory);
+			item.xml.assign(buffer, size);
+			item.dirty = false;
+			free(buffer);
+		}
+		fputs(item.xml.c_str(), fp);
+	});
+    return true;////////
+}
 
-	INDI::DefaultDevice::saveConfigItems(fp);
+//////////////////////////////////////
+/* forEachConfigItem */
+// Saved properties, in config file order. Base device and interfaces items are
+// not tracked one by one : they are cached as a whole
+void Ipx800::forEachConfigItem(const std::function<void(const char *name, const ConfigSaver &save)> &visit)
+{
+	visit("*DefaultDevice", [this](FILE *fp) { INDI::DefaultDevice::saveConfigItems(fp); });
     //IUSaveConfigText(fp, &LoginPwdTP);
 	
 	/** sauvegarde de la configuration des relais et entrées discretes **/ 
     ////////////////////////////
-	for(int i=0;i<8;i++)
-    {
-        IUSaveConfigSwitch(fp, &RelaisInfoSP[i]);
-        IUSaveConfigSwitch(fp, &DigitalInputSP[i]);
-    }
-	INDI::InputInterface::saveConfigItems(fp);
-    INDI::OutputInterface::saveConfigItems(fp);
-    return true;////////
+	for(int i=0;i<relayCount;i++)
+		visit(RelaisInfoSP[i].name, [this, i](FILE *fp) { IUSaveConfigSwitch(fp, &RelaisInfoSP[i]); });
+	for(int i=0;i<digitalCount;i++)
+		visit(DigitalInputSP[i].name, [this, i](FILE *fp) { IUSaveConfigSwitch(fp, &DigitalInputSP[i]); });
+	for (INumberVectorProperty *nvp : { &ChannelLimitNP, &RoofTimeoutNP, &RoofRunAlertNP, &MountDebounceNP, &UpdateIntervalNP,
+	                                    &AnalogScaleNP, &AnalogDeadbandNP, &DigitalFilterSamplesNP,
+	                                    &DigitalFilterTimeNP, &RelayAutoOffNP, &RelayWattsNP,
+	                                    &DewSettingsNP })
+		visit(nvp->name, [nvp](FILE *fp) { IUSaveConfigNumber(fp, nvp); });
+	for (ISwitchVectorProperty *svp : { &PublicationSP, &TabsSP, &DomeInterfaceSP, &WeatherCloseSP, &DewHeaterSP })
+		visit(svp->name, [svp](FILE *fp) { IUSaveConfigSwitch(fp, svp); });
+	for (ITextVectorProperty *tvp : { &InterlockRulesTP, &PowerSequenceTP, &WeatherSnoopTP, &DewSnoopTP })
+		visit(tvp->name, [tvp](FILE *fp) { IUSaveConfigText(fp, tvp); });
+	visit("*Interfaces", [this](FILE *fp) {
+		INDI::InputInterface::saveConfigItems(fp);
+		INDI::OutputInterface::saveConfigItems(fp);
+	});
 }
 
 //////////////////////////////////////
-/* readCommand */
-bool Ipx800::readCommand(IPX800_command rCommand) {
+/* registerConfigItems */
+// Known config items, for noteConfigChange : after initProperties and when channels change
+void Ipx800::registerConfigItems()
+{
+	forEachConfigItem([this](const char *name, const ConfigSaver &) { configCache[name]; });
+}
 
-    bool rc = false;
-    std::string ipx_url = "";
-    //int bytesWritten = 0, totalBytes = 0;
-    switch (rCommand) {
-		case GetR :
-			ipx_url = "Get=R";
-			break;
-		case GetD :
-			ipx_url = "Get=D";
+//////////////////////////////////////
+/* noteConfigChange */
+// Called before a new value is handled : the item is serialized again at next save,
+// which is done once no change came for CONFIG_SAVE_DELAY
+void Ipx800::noteConfigChange(const char *dev, const char *name)
+{
+	if (dev == nullptr || strcmp(dev, getDeviceName()) != 0)
+		return;
+	auto item = configCache.find(name);
+	if (item == configCache.end()) {
+		// maybe a base device or interface setting, saved with the next save
+		configCache["*DefaultDevice"].dirty = true;
+		configCache["*Interfaces"].dirty = true;
+		return;
+	}
+	item->second.dirty = true;
+	if (configSaveID >= 0)
+		relayTimers.cancel(configSaveID);
+	configSaveID = relayTimers.schedule(CONFIG_SAVE_DELAY, [this]() {
+		configSaveID = -1;
+		writeConfigFile();
+	});
+}
+
+//////////////////////////////////////
+/* writeConfigFile */
+// Config file replaced at once : a crash or power loss leaves either the old or the new file
+bool Ipx800::writeConfigFile()
+{
+	const char *configDir = getenv("INDICONFIG");
+	const char *home = getenv("HOME");
+	std::string path = configDir ? configDir : std::string(home ? home : ".") + "/.indi/" + getDeviceName() + "_config.xml";
+	
+	char *buffer = nullptr;
+	size_t size = 0;
+	FILE *memory = open_memstream(&buffer, &size);
+	if (memory == nullptr)
+		return false;
+	fputs("<INDIDriver>\n", memory);
+	saveConfigItems(memory);
+	fputs("</INDIDriver>\n", memory);
+	fclose(memory);
+	std::string content(buffer, size);
+	free(buffer);
+	
+	if (configWritten.empty()) {
+		std::ifstream current(path);
+		configWritten.assign(std::istreambuf_iterator<char>(current), std::istreambuf_iterator<char>());
+	}
+	if (content == configWritten)
+		return true;
+	
+	std::string temporary = path + ".tmp";
+	int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	bool written = fd >= 0 && write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size())
+	               && fsync(fd) == 0;
+	if (fd >= 0)
+		close(fd);
+	if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+		LOGF_ERROR("Configuration can't be saved in %s : %s", path.c_str(), strerror(errno));
+		unlink(temporary.c_str());
+		return false;
+	}
+	configWritten = content;
+	IPX_LOGF_DEBUG("Configuration saved in %s", path.c_str());
+	return true;
+}
+
+//////////////////////////////////////
+/* readCommand */
+bool Ipx800::readCommand(IPX800_command rCommand) {
+
+    bool rc = false;
+    const char *ipx_url = nullptr;
+    //int bytesWritten = 0, totalBytes = 0;
+    switch (rCommand) {
+		case GetR :
+			ipx_url = protocol->getRelays;
+			break;
+		case GetD :
+			ipx_url = protocol->getDigitals;
+			break;
+		case GetA :
+			ipx_url = protocol->getAnalogs;
+			break;
+		case GetC :
+			ipx_url = protocol->getCounters;
 			break;
 		default :
-		{
-			LOGF_ERROR("readCommand - Unknown Command %s", rCommand);
-			return false;
-		}
+			break;
+    }
+    if (ipx_url == nullptr) {
+		LOGF_ERROR("readCommand - Command %d unknown for IPX800 V%d", rCommand, protocol->version);
+		return false;
     }
-    LOGF_DEBUG ("readCommand - Sending %s",ipx_url.c_str());
+    IPX_LOGF_DEBUG("readCommand - Sending %s",ipx_url);
     rc = writeTCP(ipx_url);
 
     return rc;
@@ -725,33 +1609,26 @@ bool Ipx800::readCommand(IPX800_command rCommand) {
 /* writeCommand */
 bool Ipx800::writeCommand(IPX800_command wCommand, int toSet) {
 
-    std::string ipx_url;
-    std::string number;
-	
+	const char *format = nullptr;
+	char ipx_url[32];
 	
     bool rc = false;
-    //int bytesWritten = 0, totalBytes = 0;
-    if (toSet <10)
-        number = "0"+ std::to_string(toSet);
-    else {
-        number = std::to_string(toSet);
-    }
     switch (wCommand) {
 		case SetR :
-			ipx_url = "SetR=" + number ;
-			LOGF_DEBUG ("Sending Set R %s",number.c_str());
+			format = protocol->setRelay;
 			break;
 		case ClearR :
-			ipx_url = "ClearR=" + number;
-			LOGF_DEBUG ("Sending Clear R %s",number.c_str());
+			format = protocol->clearRelay;
 			break;
 		default :
-		{
-			LOGF_ERROR("Unknown Command %s", wCommand);
-			return false;
-		}
-
+			break;
     }
+    if (format == nullptr) {
+		LOGF_ERROR("Command %d unknown for IPX800 V%d", wCommand, protocol->version);
+		return false;
+    }
+    snprintf(ipx_url, sizeof(ipx_url), format, toSet);
+    IPX_LOGF_DEBUG("Sending %s", ipx_url);
     rc = writeTCP(ipx_url); 
 	
     return rc;
@@ -763,30 +1640,44 @@ void Ipx800::readAnswer(){
     int received = 0;
     int bytes, total = 0;
     int portFD = tcpConnection->getPortFD();
-    char tmp[58] = "";
-    total = 58;
+    char tmp[sizeof(rawAnswer)] = "";
+    total = sizeof(tmp) - 1;
 	int i = 0;
+    // an answer ends with its line feed, whatever its length
     do {
         bytes = read(portFD,tmp+received,total-received);
 
         if (bytes < 0) {
-            LOGF_ERROR("readAnswer - ERROR reading response from socket : %s", strerror(errno));
+            m2mCapture.record(M2MCapture::CAP_ERROR);
+            IPX_LOGF_ERROR_LIMITED("readAnswer - ERROR reading response from socket : %s", strerror(errno));
             //std::this_thread::sleep_for(std::chrono::milliseconds(500));
 			i++;
 			if (i>2)
 				break;
+			continue;
 			}
         else if (bytes == 0) {
-            LOG_DEBUG("readAnswer : end of stream");
+            m2mCapture.record(M2MCapture::CAP_EOF);
+            IPX_LOG_ERROR_LIMITED("readAnswer : end of stream");
             break; }
+        else
+            m2mCapture.record(M2MCapture::CAP_RX, tmp+received, bytes);
         received+=bytes;
-    } while (received < total);
+    } while (received < total && memchr(tmp, '\n', received) == nullptr);
+	
+	// "<command>=<data>" answers : data only
+	int skipped = 0;
+	if (protocol->echoesCommand && received > static_cast<int>(lastRequest.size())
+	    && strncmp(tmp, lastRequest.c_str(), lastRequest.size()) == 0 && tmp[lastRequest.size()] == '=')
+		skipped = lastRequest.size() + 1;
 
-    LOGF_DEBUG("readAnswer - Longeur reponse : %i", received);
+    IPX_LOGF_TRACE("readAnswer - Longeur reponse : %i", received);
 	
-    strncpy(tmpAnswer,tmp,8);
+    answerLength = std::min<int>(received - skipped, sizeof(rawAnswer) - 1);
+    memcpy(rawAnswer, tmp + skipped, answerLength);
+    rawAnswer[answerLength] = '\0';
 	
-    LOGF_DEBUG ("readAnswer - Reponse reçue : %s", tmpAnswer);
+    IPX_LOGF_DEBUG("readAnswer - Reponse reçue : %s", rawAnswer);
 
   };
 
@@ -794,150 +1685,217 @@ void Ipx800::readAnswer(){
 /* recordData */
 void Ipx800::recordData(IPX800_command recCommand) {
     int i = -1;
-	int tmpDR = UNUSED_DIGIT;
 	switch (recCommand) {
     case GetD :
-			for (i=0;i<8;i++){				
-				DigitsStatesSP[i].s = IPS_OK;
+		{
+			uint64_t raw = answerBits;
+			
+			// ROOF_ENGINE_POWERED, RASPBERRY_SUPPLIED, MAIN_PC_SUPPLIED logic's is reversed
+			// only accepted transitions are published
+			uint64_t changed = filterDigitalInputs(raw ^ reversedDigitals, monotonicMs());
+			bool groupChanged = changed != 0;
+			while (changed) {
+				i = __builtin_ctzll(changed);
+				changed &= changed - 1;
+				
+				eventLog.record(monotonicMs(), EventLog::EV_DIGITAL, i, EventLog::CAUSE_POLL, digitalState[i], (digitalFiltered >> i) & 1u);
+				digitalState[i] = (digitalFiltered >> i) & 1u;
+				IPX_LOGF_DEBUG("recordData - Digital Input N° %d is %s",i+1, digitalState[i] ? "ON" : "OFF");
 				DigitalInputsSP[i].reset();
-				if (tmpAnswer[i] == '0') {
-					LOGF_DEBUG("recordData - Digital Input N° %d is %s",i+1,"OFF");
-					DigitalInputsSP[i][0].setState(ISS_ON);
-					DigitsStatesSP[i].sp[0].s = ISS_OFF;
-					DigitsStatesSP[i].sp[1].s = ISS_ON;
-					digitalState[i] = false;}
-				else if(tmpAnswer[i] == '1'){
-					LOGF_DEBUG("recordData - Digital Input N° %d is %s",i+1,"ON");
-					DigitalInputsSP[i][1].setState(ISS_ON);
-					DigitsStatesSP[i].sp[0].s = ISS_ON ;
-					DigitsStatesSP[i].sp[1].s = ISS_OFF;
-					digitalState[i] = true;
-				}
-				tmpAnswer[i] = ' ';
-			    DigitalInputsSP[i].setState(IPS_OK);
-                DigitalInputsSP[i].apply();
-			    defineProperty(&DigitsStatesSP[i]);
+				DigitalInputsSP[i][digitalState[i] ? 1 : 0].setState(ISS_ON);
+				DigitalInputsSP[i].setState(IPS_OK);
+				DigitalInputsSP[i].apply();
+				DigitsStatesSP[i].sp[0].s = digitalState[i] ? ISS_ON : ISS_OFF;
+				DigitsStatesSP[i].sp[1].s = digitalState[i] ? ISS_OFF : ISS_ON;
 				DigitsStatesSP[i].s = IPS_OK;
-				IDSetSwitch(&DigitsStatesSP[i], nullptr);
+				channelStateL[DIGITAL_CHANNELS][i].s = digitalState[i] ? IPS_OK : IPS_IDLE;
+				if (!compactPublication)
+					IDSetSwitch(&DigitsStatesSP[i], nullptr);
+			}
+			if (compactPublication && groupChanged) {
+				channelStateLP[DIGITAL_CHANNELS].s = IPS_OK;
+				IDSetLight(&channelStateLP[DIGITAL_CHANNELS], nullptr);
 			}
 			
-			for (i=0;i<10;i++) {
-				tmpDR = Digital_Fonction_Tab[i];
-				if (tmpDR >= 0) {
-					 
-					if (tmpDR == ROOF_ENGINE_POWERED ) {
-						DigitalInputsSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]].reset();
-						if (DigitsStatesSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]].sp[0].s == ISS_OFF) {
-							LOG_DEBUG("recordData - reversing ROOF_ENGINE_POWERED TO ON");
-							
-							DigitsStatesSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]].sp[0].s  = ISS_ON;
-							DigitsStatesSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]].sp[1].s = ISS_OFF;
-							digitalState[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]] = true;
-							DigitalInputsSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]][1].setState(ISS_ON);}
-						else {
-							LOG_DEBUG("recordData - reversing ROOF_ENGINE_POWERED TO OFF");
-							DigitsStatesSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]].sp[0].s = ISS_OFF;
-							DigitsStatesSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]].sp[1].s = ISS_ON;
-							digitalState[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]] = false;
-							DigitalInputsSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]][0].setState(ISS_ON);}
-						
-						
-						DigitalInputsSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]].setState(IPS_OK);
-						DigitalInputsSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]].apply();		
-						defineProperty(&DigitsStatesSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]]);
-						DigitsStatesSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]].s = IPS_OK;
-						IDSetSwitch(&DigitsStatesSP[Digital_Fonction_Tab[ROOF_ENGINE_POWERED]], nullptr);
-						
-					}
-					else if(tmpDR == RASPBERRY_SUPPLIED) {
-						DigitalInputsSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]].reset();
-						if (DigitsStatesSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]].sp[0].s == ISS_OFF) {
-							LOG_DEBUG("recordData - reversing RASPBERRY_SUPPLIED TO ON");
-							DigitsStatesSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]].sp[0].s  = ISS_ON;
-							DigitsStatesSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]].sp[1].s = ISS_OFF;
-							digitalState[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]] = true;
-							DigitalInputsSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]][1].setState(ISS_ON);}
-						else {
-							LOG_DEBUG("recordData - reversing RASPBERRY_SUPPLIED TO OFF");
-							DigitsStatesSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]].sp[0].s = ISS_OFF;
-							DigitsStatesSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]].sp[1].s = ISS_ON;
-							digitalState[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]] = false;
-							DigitalInputsSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]][0].setState(ISS_ON);}
-							
-						DigitalInputsSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]].setState(IPS_OK);
-						DigitalInputsSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]].apply();	
-						defineProperty(&DigitsStatesSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]]);
-						DigitsStatesSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]].s = IPS_OK;
-						IDSetSwitch(&DigitsStatesSP[Digital_Fonction_Tab[RASPBERRY_SUPPLIED]], nullptr);
-						
+			int enginePoweredInput = digitalForFunction(ROOF_ENGINE_POWERED);
+			enginePowered = enginePoweredInput >= 0 && digitalState[enginePoweredInput];
+		}
+		break;
+    case GetR :
+		{
+			// only relays changed since last published are sent, all of them after connection
+			uint64_t mask = relayCount < 64 ? (1ull << relayCount) - 1 : ~0ull;
+			uint64_t changed = relayPublishedValid ? (answerBits ^ relayPublished) & mask : mask;
+			for (int i=0;i<relayCount;i++){
+				bool on = (answerBits >> i) & 1u;
+				if (on != relayState[i])
+					eventLog.record(monotonicMs(), EventLog::EV_RELAY, i, EventLog::CAUSE_POLL, relayState[i], !relayState[i]);
+				relayState[i] = on;
+				RelaysStatesSP[i].sp[0].s = on ? ISS_ON : ISS_OFF;
+				RelaysStatesSP[i].sp[1].s = on ? ISS_OFF : ISS_ON;
+				RelaysStatesSP[i].s = IPS_OK;
+				channelStateL[RELAY_CHANNELS][i].s = on ? IPS_OK : IPS_IDLE;
+				if (((changed >> i) & 1u) == 0)
+					continue;
+				
+				IPX_LOGF_TRACE("recordData - Relay N° %d is %s",i+1, on ? "ON" : "OFF");
+				DigitalOutputsSP[i].reset();
+				DigitalOutputsSP[i][on ? 1 : 0].setState(ISS_ON);
+				DigitalOutputsSP[i].setState(IPS_OK);
+				DigitalOutputsSP[i].apply();
+				if (!compactPublication)
+					IDSetSwitch(&RelaysStatesSP[i], nullptr);
+			}
+			relayPublished = answerBits & mask;
+			relayPublishedValid = true;
+			if (compactPublication && changed) {
+				channelStateLP[RELAY_CHANNELS].s = IPS_OK;
+				IDSetLight(&channelStateLP[RELAY_CHANNELS], nullptr);
+			}
+		}
+        break;
+    case GetA :
+		{
+			// all analog inputs in one answer, "A1=xxx&A2=xxx&..." : values taken in order
+			double raw[ANALOG_INPUTS];
+			if (parseAnswerFields(rawAnswer, raw, ANALOG_INPUTS) < ANALOG_INPUTS) {
+				LOGF_ERROR("recordData - Wrong analog answer : %s", rawAnswer);
+				break;
+			}
+			
+			bool statsChanged = !analogPrimed;
+			for (i=0;i<ANALOG_INPUTS;i++) {
+				double value = raw[i] * AnalogScaleN[2*i].value + AnalogScaleN[2*i+1].value;
+				analogWindow[i].push(value);
+				
+				// statistics follow the window at every poll, publishLimited paces them
+				double stats[3] = { analogWindow[i].min(), analogWindow[i].mean(), analogWindow[i].max() };
+				for (int s=0;s<3;s++) {
+					if (stats[s] != AnalogStatsN[3*i+s].value) {
+						AnalogStatsN[3*i+s].value = stats[s];
+						statsChanged = true;
 					}
-					else if (tmpDR == MAIN_PC_SUPPLIED) {
-						DigitalInputsSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]].reset();						
-						if (DigitsStatesSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]].sp[0].s == ISS_OFF) {
-							LOG_DEBUG("recordData - reversing MAIN_PC_SUPPLIED TO ON");
-							DigitsStatesSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]].sp[0].s  = ISS_ON;
-							DigitsStatesSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]].sp[1].s = ISS_OFF;
-							digitalState[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]] = true; 
-							DigitalInputsSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]][1].setState(ISS_ON);}
-						else {
-							LOG_DEBUG("recordData - reversing MAIN_PC_SUPPLIED TO OFF");
-							DigitsStatesSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]].sp[0].s = ISS_OFF;
-							DigitsStatesSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]].sp[1].s = ISS_ON;
-							digitalState[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]] = false;
-							DigitalInputsSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]][0].setState(ISS_ON);}
-						
-						DigitalInputsSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]].setState(IPS_OK);
-						DigitalInputsSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]].apply();	
-						defineProperty(&DigitsStatesSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]]);
-						DigitsStatesSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]].s = IPS_OK;
-						IDSetSwitch(&DigitsStatesSP[Digital_Fonction_Tab[MAIN_PC_SUPPLIED]], nullptr);
+				}
+				
+				// the value itself is only published out of its deadband
+				double deadband = AnalogDeadbandN[i].value;
+				if (analogPrimed && std::fabs(value - analogPublished[i]) <= deadband)
+					continue;
+				analogPublished[i] = value;
+				AnalogInputsNP[i][0].setValue(value);
+				AnalogInputsNP[i].setState(IPS_OK);
+				publishLimited(LIMITED_ANALOG + i, IPS_OK, [this, i]() { AnalogInputsNP[i].apply(); });
+			}
+			analogPrimed = true;
+			if (statsChanged) {
+				AnalogStatsNP.s = IPS_OK;
+				publishLimited(LIMITED_ANALOG_STATS, IPS_OK, [this]() { IDSetNumber(&AnalogStatsNP, nullptr); });
+			}
+		}
+		break;
+    case GetC :
+		{
+			// counters in one answer, "C1=xxx&C2=xxx&C3=xxx"
+			double raw[COUNTERS];
+			if (parseAnswerFields(rawAnswer, raw, COUNTERS) < COUNTERS) {
+				LOGF_ERROR("recordData - Wrong counters answer : %s", rawAnswer);
+				break;
+			}
+			
+			uint64_t now = monotonicMs();
+			double elapsed = counterPrimed ? (now - counterLastAt) / 1000.0 : 0;
+			bool changed = !counterPrimed;
+			for (i=0;i<COUNTERS;i++) {
+				uint32_t count = static_cast<uint32_t>(raw[i]);
+				if (elapsed > 0) {
+					// unsigned difference is right across a 32 bits wraparound,
+					// a counter reset on IPX800 side only restarts from its new value
+					uint32_t delta = count - counterLast[i];
+					if (count < counterLast[i] && counterLast[i] < 0xF0000000u)
+						delta = count;
+					double perSecond = delta / elapsed;
+					double smoothing = 1.0 - std::exp(-elapsed / 60.0);
+					counterRate[i] += smoothing * (perSecond * 60.0 - counterRate[i]);
+					double perMinute = counterRate[i];
 					
+					// rates only published on significant change from the published values
+					if (std::fabs(perSecond - CountersN[3*i+1].value) > 0.02 * std::max(std::fabs(CountersN[3*i+1].value), 0.05)
+						|| std::fabs(perMinute - CountersN[3*i+2].value) > 0.02 * std::max(std::fabs(CountersN[3*i+2].value), 0.05)) {
+						CountersN[3*i+1].value = perSecond;
+						CountersN[3*i+2].value = perMinute;
+						changed = true;
 					}
 				}
-				else {
-					LOGF_WARN("Wrong Digital ROOF_ENGINE_POWERED initialisation. Now it's = %d",tmpDR);
+				if (count != counterLast[i] || !counterPrimed) {
+					CountersN[3*i].value = count;
+					changed = true;
 				}
-
-		enginePowered = digitalState[Digital_Fonction_Tab [ROOF_ENGINE_POWERED]];
+				counterLast[i] = count;
 			}
+			counterLastAt = now;
+			counterPrimed = true;
+			if (changed) {
+				CountersNP.s = IPS_OK;
+				publishLimited(LIMITED_COUNTERS, IPS_OK, [this]() { IDSetNumber(&CountersNP, nullptr); });
+			}
+		}
 		break;
-    case GetR :
-        for (int i=0;i<8;i++){
-            RelaysStatesSP[i].s = IPS_OK;
-			DigitalOutputsSP[i].reset();
-            if (tmpAnswer[i] == '0') {
-                LOGF_DEBUG("recordData - Relay N° %d is %s",i+1,"OFF");
-                RelaysStatesSP[i].sp[0].s = ISS_OFF;
-                RelaysStatesSP[i].sp[1].s = ISS_ON;
-				DigitalOutputsSP[i][0].setState(ISS_ON);
-                //relayState[i]= false;
-            }
-            else {
-                LOGF_DEBUG("recordData - Relay N° %d is %s",i+1,"ON");
-                RelaysStatesSP[i].sp[0].s  = ISS_ON;
-                RelaysStatesSP[i].sp[1].s  = ISS_OFF;
-				DigitalOutputsSP[i][1].setState(ISS_ON);
-                //relayState[i]=true;
-            }
-            tmpAnswer[i] = ' ';
-			DigitalOutputsSP[i].setState(IPS_OK);
-            DigitalOutputsSP[i].apply();
-			RelaysStatesSP[i].s = IPS_OK;
-			
-			IDSetSwitch(&RelaysStatesSP[i], nullptr);
-			//defineProperty(&RelaysStatesSP[i]);
-			
-        }
-        break;
     default :
         LOGF_ERROR("recordData - Unknown Command %s", recCommand);
         break;
     }
 	
-    LOG_DEBUG("recordData - Switches States Recorded");
+    IPX_LOG_TRACE("recordData - Switches States Recorded");
 
 };
 
+//////////////////////////////////////
+/* filterDigitalInputs */
+// Glitch filter on packed digital inputs word. Only channels whose raw state
+// differs from the accepted one are examined. Returns accepted transitions.
+uint64_t Ipx800::filterDigitalInputs(uint64_t raw, uint64_t now)
+{
+	if (!digitalFilterPrimed) {
+		// first snapshot since connection is taken as is
+		digitalFiltered = raw;
+		digitalPending = 0;
+		digitalFilterPrimed = true;
+		std::fill(digitalLastEdge.begin(), digitalLastEdge.end(), now);
+		return digitalCount < 64 ? (1ull << digitalCount) - 1 : ~0ull;
+	}
+	
+	uint64_t diff = raw ^ digitalFiltered;
+	uint64_t started = diff & ~digitalPending;
+	uint64_t changed = 0;
+	
+	// channels back to their accepted state are dropped, new ones start counting
+	digitalPending = diff;
+	while (started) {
+		int i = __builtin_ctzll(started);
+		started &= started - 1;
+		digitalPendingCount[i] = 0;
+		digitalPendingSince[i] = now;
+	}
+	
+	uint64_t pending = digitalPending;
+	while (pending) {
+		int i = __builtin_ctzll(pending);
+		pending &= pending - 1;
+		if (digitalPendingCount[i] < 255)
+			digitalPendingCount[i]++;
+		if (digitalPendingCount[i] >= DigitalFilterSamplesN[i].value &&
+			now - digitalPendingSince[i] >= DigitalFilterTimeN[i].value) {
+			digitalFiltered ^= 1ull << i;
+			digitalPending &= ~(1ull << i);
+			digitalLastEdge[i] = digitalPendingSince[i];
+			changed |= 1ull << i;
+		}
+		else
+			IPX_LOGF_DEBUG("filterDigitalInputs - Digital Input N° %d change pending (%d samples)", i+1, digitalPendingCount[i]);
+	}
+	return changed;
+}
+
 //////////////////////////////////////
 /* writeTCP Write Command on TCP socket */
 bool Ipx800::writeTCP(std::string toSend) {
@@ -946,26 +1904,26 @@ bool Ipx800::writeTCP(std::string toSend) {
     totalBytes = toSend.length();
     int portFD = tcpConnection->getPortFD();
 
-    LOGF_DEBUG("writeTCP - Command to send %s", toSend.c_str());
-    LOGF_DEBUG ("writeTCP - Numéro de socket %i", portFD);
+    IPX_LOGF_TRACE("writeTCP - Command to send %s on socket %i", toSend.c_str(), portFD);
 
     if (!isSimulation()) {
         while (bytesWritten < totalBytes)
         {
-			int bytesSent = write(portFD, toSend.c_str(), totalBytes - bytesWritten);
+			int bytesSent = write(portFD, toSend.c_str() + bytesWritten, totalBytes - bytesWritten);
             if (bytesSent >= 0)
                 bytesWritten += bytesSent;
 				
             else
             {
-                LOGF_ERROR("writeTCP - Error request to IPX800. %s", strerror(errno));
+                IPX_LOGF_ERROR_LIMITED("writeTCP - Error request to IPX800. %s", strerror(errno));
                 return false;
             }
         }
+        m2mCapture.record(M2MCapture::CAP_TX, toSend.c_str(), bytesWritten);
+        lastRequest = toSend;
     }
 
-    LOGF_DEBUG ("writeTCP - bytes to send : %s", toSend.c_str());
-    LOGF_DEBUG ("writeTCP - Number of bytes sent : %d", bytesWritten);
+    IPX_LOGF_TRACE("writeTCP - Number of bytes sent : %d", bytesWritten);
     return true;
 }
 
@@ -978,7 +1936,7 @@ bool Ipx800::writeTCP(std::string toSend) {
 bool Ipx800::updateIPXData()
 {
     bool res = false;
-	LOG_DEBUG("Updating IPX Data...");
+	IPX_LOG_TRACE("Updating IPX Data...");
 	
     res = UpdateDigitalOutputs();
     if (res==false) {
@@ -991,66 +1949,1437 @@ bool Ipx800::updateIPXData()
         LOG_ERROR("updateIPXData - Send Command GetD failed");
 		return false;
     }
+	
+    res = UpdateAnalogInputs();
+    if (res==false) {
+        LOG_ERROR("updateIPXData - Send Command GetA failed");
+		return false;
+    }
+	
+    res = UpdateCounters();
+    if (res==false) {
+        LOG_ERROR("updateIPXData - Send Command GetC failed");
+		return false;
+    }
+	
+	saveSnapshot();
+	updateRelayUsage();
+	
+	if (connectStartMs != 0 && relayPublishedValid && digitalFilterPrimed) {
+		LOGF_INFO("First valid state %u ms after connection request", static_cast<unsigned>(monotonicMs() - connectStartMs));
+		connectStartMs = 0;
+	}
   
     return true;
 }
 
+//////////////////////////////////////
+/* applySnapshot */
+// Last known state taken as current one, IPS_BUSY until the first live read publishes it again as IPS_OK
+void Ipx800::applySnapshot()
+{
+	const StateSnapshot::State &lastState = stateSnapshot.state();
+	
+	for (int i=0;i<relayCount;i++) {
+		relayState[i] = (lastState.relayBits >> i) & 1u;
+		RelaysStatesSP[i].sp[0].s = relayState[i] ? ISS_ON : ISS_OFF;
+		RelaysStatesSP[i].sp[1].s = relayState[i] ? ISS_OFF : ISS_ON;
+		RelaysStatesSP[i].s = IPS_BUSY;
+		channelStateL[RELAY_CHANNELS][i].s = relayState[i] ? IPS_OK : IPS_IDLE;
+	}
+	for (int i=0;i<digitalCount;i++) {
+		digitalState[i] = (lastState.digitalBits >> i) & 1u;
+		DigitsStatesSP[i].sp[0].s = digitalState[i] ? ISS_ON : ISS_OFF;
+		DigitsStatesSP[i].sp[1].s = digitalState[i] ? ISS_OFF : ISS_ON;
+		DigitsStatesSP[i].s = IPS_BUSY;
+		channelStateL[DIGITAL_CHANNELS][i].s = digitalState[i] ? IPS_OK : IPS_IDLE;
+	}
+	channelStateLP[RELAY_CHANNELS].s = IPS_BUSY;
+	channelStateLP[DIGITAL_CHANNELS].s = IPS_BUSY;
+	
+	if (lastState.mountStatus <= NONE_PARKED)
+		Mount_Status = mountCandidate = static_cast<decltype(Mount_Status)>(lastState.mountStatus);
+	IUResetSwitch(&MountParkSP);
+	MountParkS[Mount_Status].s = ISS_ON;
+	MountParkSP.s = IPS_BUSY;
+	
+	if (lastState.roofStatus <= UNKNOWN_STATUS)
+		Roof_Status = static_cast<decltype(Roof_Status)>(lastState.roofStatus);
+	RoofStatusL[0].s = (Roof_Status == ROOF_IS_OPENED) ? IPS_OK : IPS_IDLE;
+	RoofStatusL[1].s = (Roof_Status == ROOF_IS_CLOSED) ? IPS_OK : IPS_IDLE;
+	RoofStatusLP.s = IPS_BUSY;
+	
+	snapshotPending = true;
+}
+
+//////////////////////////////////////
+/* saveSnapshot */
+// After each successful poll : the file is only written when the state changed
+void Ipx800::saveSnapshot()
+{
+	StateSnapshot::State state = {};
+	for (int i=0;i<relayCount;i++)
+		state.relayBits |= static_cast<uint64_t>(relayState[i]) << i;
+	for (int i=0;i<digitalCount;i++)
+		state.digitalBits |= static_cast<uint64_t>(digitalState[i]) << i;
+	state.relays = relayCount;
+	state.digitals = digitalCount;
+	state.mountStatus = Mount_Status;
+	state.roofStatus = Roof_Status;
+	stateSnapshot.save(state);
+}
+
+//////////////////////////////////////
+/* updateRelayUsage */
+// After each successful poll : counters follow the relays that changed, values are
+// published every USAGE_PUBLISH_INTERVAL and saved every USAGE_SAVE_INTERVAL
+void Ipx800::updateRelayUsage()
+{
+	uint64_t now = realtimeMs(), tick = monotonicMs();
+	uint64_t mask = relayCount < 64 ? (1ull << relayCount) - 1 : ~0ull;
+	relayUsage.update(relayPublished, mask, now);
+	
+	if (usagePublishedAt == 0 || tick - usagePublishedAt >= USAGE_PUBLISH_INTERVAL) {
+		for (int i=0;i<relayCount;i++) {
+			double hours = relayUsage.onMs(i, now) / 3600000.0;
+			RelayUsageN[4*i].value = hours;
+			RelayUsageN[4*i+1].value = relayUsage.cycles(i);
+			RelayUsageN[4*i+2].value = hours * RelayWattsN[i].value / 1000.0;
+			RelayUsageN[4*i+3].value = relayUsage.duty(i, now) * 100.0;
+		}
+		RelayUsageNP.s = IPS_OK;
+		IDSetNumber(&RelayUsageNP, nullptr);
+		usagePublishedAt = tick;
+	}
+	if (tick - usageSavedAt >= USAGE_SAVE_INTERVAL) {
+		relayUsage.save(now);
+		usageSavedAt = tick;
+	}
+}
+
 //////////////////////////////////////
 /* updateObsStatus */
+// Roof supervision, called on each fresh digital inputs snapshot
 void Ipx800::updateObsStatus()
 {
+	int openedInput = digitalForFunction(ROOF_OPENED);
+	int closedInput = digitalForFunction(ROOF_CLOSED);
+	
+	if (openedInput < 0 || closedInput < 0) {
+		Roof_Status = UNKNOWN_STATUS;
+		publishRoofStatus();
+		return;
+	}
+	
+	fullOpenLimitSwitch = digitalState[openedInput] ? ISS_ON : ISS_OFF;
+	fullClosedLimitSwitch = digitalState[closedInput] ? ISS_ON : ISS_OFF;
+	
+	if (fullOpenLimitSwitch == ISS_ON && fullClosedLimitSwitch == ISS_ON) {
+		// Both limit switches can't be seen at once : sensor or wiring failure
+		Roof_Status = UNKNOWN_STATUS;
+		Roof_Motion = ROOF_STOPPED;
+		if (!roofFault)
+			cutRoofPower("both roof limit switches are active");
+		roofFault = true;
+	}
+	else if (fullOpenLimitSwitch == ISS_ON && Roof_Motion != ROOF_CLOSING) {
+		if (Roof_Motion != ROOF_STOPPED)
+			LOGF_INFO("Roof opened in %.1f s", MotionRequest - CalcTimeLeft(MotionStart));
+		if (Roof_Motion == ROOF_OPENING)
+			recordRoofRun(RoofRuns::OPEN, digitalLastEdge[openedInput]);
+		Roof_Status = ROOF_IS_OPENED;
+		Roof_Motion = ROOF_STOPPED;
+		roofFault = false;
+	}
+	else if (fullClosedLimitSwitch == ISS_ON && Roof_Motion != ROOF_OPENING) {
+		if (Roof_Motion != ROOF_STOPPED)
+			LOGF_INFO("Roof closed in %.1f s", MotionRequest - CalcTimeLeft(MotionStart));
+		if (Roof_Motion == ROOF_CLOSING)
+			recordRoofRun(RoofRuns::CLOSE, digitalLastEdge[closedInput]);
+		Roof_Status = ROOF_IS_CLOSED;
+		Roof_Motion = ROOF_STOPPED;
+		roofFault = false;
+		weatherCloseIssued = false;
+	}
+	else if (Roof_Motion == ROOF_STOPPED && fullOpenLimitSwitch == ISS_OFF && fullClosedLimitSwitch == ISS_OFF) {
+		// Roof left its limit switch without a command from this driver
+		if (Roof_Status == ROOF_IS_OPENED || Roof_Status == ROOF_IS_CLOSED) {
+			LOG_WARN("Roof left its limit switch, supervising motion");
+			startRoofMotion(false);
+		}
+		Roof_Status = UNKNOWN_STATUS;
+	}
 	
+	if (Roof_Motion != ROOF_STOPPED && CalcTimeLeft(MotionStart) <= 0) {
+		Roof_Motion = ROOF_STOPPED;
+		roofFault = true;
+		cutRoofPower("roof travel timeout exceeded");
+	}
+	
+	publishRoofStatus();
 }
 
 //////////////////////////////////////
-/* randomInit */
-bool Ipx800::firstFonctionTabInit()
+/* updateMountStatus */
+// Mount_Status from DEC/RA axis parked inputs, called on each fresh digital inputs snapshot
+// A new status is accepted only when stable during the debounce time
+void Ipx800::updateMountStatus()
 {
-	int currentDIndex = -1;
-	int currentRIndex = -1;
-	//int cptD, cptR =0;
-	for(int i=0;i<8;i++)
-	{
-		currentRIndex = IUFindOnSwitchIndex(&RelaisInfoSP[i]);
-		if (currentRIndex != -1) {
-			Relay_Fonction_Tab [currentRIndex] = i;
-			LOGF_DEBUG("firstFonctionTabInit - Relay %d is supporting function %d ",i+1, currentRIndex);
-			currentRIndex = -1; 
-			//if (currentRIndex >0)
-			//	cptR = cptR +1;
+	int decInput = digitalForFunction(DEC_AXIS_PARKED);
+	int raInput = digitalForFunction(RA_AXIS_PARKED);
+	bool decParked = decInput >= 0 && digitalState[decInput];
+	bool raParked = raInput >= 0 && digitalState[raInput];
+	uint64_t now = monotonicMs();
+	
+	decltype(Mount_Status) candidate = NONE_PARKED;
+	if (decParked && raParked)
+		candidate = BOTH_PARKED;
+	else if (raParked)
+		candidate = RA_PARKED;
+	else if (decParked)
+		candidate = DEC_PARKED;
+	
+	if (candidate != mountCandidate || mountCandidateSince == 0) {
+		mountCandidate = candidate;
+		mountCandidateSince = now;
+	}
+	
+	if ((mountCandidate != Mount_Status || !mountAccepted) && now - mountCandidateSince >= MountDebounceN[0].value) {
+		LOGF_INFO("Mount park status : %s", MountParkS[mountCandidate].label);
+		Mount_Status = mountCandidate;
+		mountAccepted = true;
+		publishMountStatus(IPS_OK);
+	}
+	else if (!mountAccepted && MountParkSP.s != IPS_BUSY) {
+		// first snapshot since connection : default or last known status, not observed yet
+		publishMountStatus(IPS_BUSY);
+	}
+}
+
+//////////////////////////////////////
+/* publishMountStatus */
+void Ipx800::publishMountStatus(IPState state)
+{
+	IUResetSwitch(&MountParkSP);
+	MountParkS[Mount_Status].s = ISS_ON;
+	MountParkSP.s = state;
+	IDSetSwitch(&MountParkSP, nullptr);
+}
+
+//////////////////////////////////////
+/* compileInterlockRules */
+// Rules are separated by ';' : TARGET[=ON|OFF] requires COND[, COND...]
+// TARGET is a relay function, COND is NAME[=ON|OFF] with NAME a relay function,
+// a digital function, BOTH_PARKED, ROOF_IS_OPENED or ROOF_IS_CLOSED.
+// Each rule becomes a (mask, value) predicate on interlockWord.
+bool Ipx800::compileInterlockRules(const char *rules)
+{
+	std::vector<InterlockRule> compiled;
+	std::string text = rules ? rules : "";
+	
+	// NAME[=ON|OFF] -> bit of interlockWord and state. Returns relay function, 0 for other names, -1 if unknown
+	auto parseTerm = [&](std::string term, uint32_t &bit, bool &on) {
+		term = trimToken(term);
+		on = true;
+		size_t eq = term.find('=');
+		if (eq != std::string::npos) {
+			std::string state = trimToken(term.substr(eq + 1));
+			if (strcasecmp(state.c_str(), "OFF") == 0)
+				on = false;
+			else if (strcasecmp(state.c_str(), "ON") != 0)
+				return -1;
+			term = trimToken(term.substr(0, eq));
+		}
+		int f = findFunction(RelayFunctionNames, 11, term);
+		if (f > 0) {
+			bit = INTERLOCK_RELAY_BIT(f);
+			return f;
+		}
+		f = findFunction(DigitalFunctionNames, 10, term);
+		if (f > 0) {
+			bit = INTERLOCK_DIGITAL_BIT(f);
+			return 0;
+		}
+		bit = 0;
+		if (strcasecmp(term.c_str(), "BOTH_PARKED") == 0)
+			bit = INTERLOCK_BOTH_PARKED;
+		else if (strcasecmp(term.c_str(), "ROOF_IS_OPENED") == 0)
+			bit = INTERLOCK_ROOF_OPENED;
+		else if (strcasecmp(term.c_str(), "ROOF_IS_CLOSED") == 0)
+			bit = INTERLOCK_ROOF_CLOSED;
+		return bit ? 0 : -1;
+	};
+	
+	size_t start = 0;
+	while (start < text.size()) {
+		size_t end = text.find(';', start);
+		if (end == std::string::npos)
+			end = text.size();
+		std::string ruleText = text.substr(start, end - start);
+		start = end + 1;
+		ruleText = trimToken(ruleText);
+		if (ruleText.empty())
+			continue;
+		
+		size_t requires = ruleText.find(" requires ");
+		if (requires == std::string::npos) {
+			LOGF_ERROR("Interlock rule \"%s\" : missing \"requires\"", ruleText.c_str());
+			return false;
+		}
+		
+		InterlockRule rule { 0, INDI::OutputInterface::On, 0, 0, true, ruleText };
+		uint32_t bit = 0;
+		bool on = true;
+		rule.target = parseTerm(ruleText.substr(0, requires), bit, on);
+		if (rule.target <= 0) {
+			LOGF_ERROR("Interlock rule \"%s\" : target must be a relay function", ruleText.c_str());
+			return false;
+		}
+		rule.command = on ? INDI::OutputInterface::On : INDI::OutputInterface::Off;
+		
+		std::string conditions = ruleText.substr(requires + 10);
+		size_t cStart = 0;
+		while (cStart <= conditions.size()) {
+			size_t cEnd = conditions.find(',', cStart);
+			if (cEnd == std::string::npos)
+				cEnd = conditions.size();
+			if (parseTerm(conditions.substr(cStart, cEnd - cStart), bit, on) < 0) {
+				LOGF_ERROR("Interlock rule \"%s\" : unknown condition", ruleText.c_str());
+				return false;
 			}
-		else
-			LOGF_DEBUG("firstFonctionTabInit - Function unknown for Relay %d", i+1);
+			rule.mask |= bit;
+			if (on)
+				rule.value |= bit;
+			cStart = cEnd + 1;
+		}
+		compiled.push_back(rule);
+	}
+	
+	interlockRules.swap(compiled);
+	updateInterlocks(true);
+	LOGF_INFO("%d interlock rule(s) active", static_cast<int>(interlockRules.size()));
+	return true;
+}
+
+//////////////////////////////////////
+/* updateInterlocks */
+// Called on each snapshot : only rules depending on changed bits are evaluated again.
+// full = true evaluates every rule from scratch (rules reloaded)
+void Ipx800::updateInterlocks(bool full)
+{
+	uint32_t word = 0;
+	for (int f=1;f<11;f++) {
+		int relay = relayForFunction(f);
+		if (relay >= 0 && relayState[relay])
+			word |= INTERLOCK_RELAY_BIT(f);
+	}
+	for (int f=1;f<10;f++) {
+		int digit = digitalForFunction(f);
+		if (digit >= 0 && digitalState[digit])
+			word |= INTERLOCK_DIGITAL_BIT(f);
+	}
+	// only a park status observed since connection satisfies a rule
+	if (mountAccepted && Mount_Status == BOTH_PARKED)
+		word |= INTERLOCK_BOTH_PARKED;
+	if (Roof_Status == ROOF_IS_OPENED)
+		word |= INTERLOCK_ROOF_OPENED;
+	if (Roof_Status == ROOF_IS_CLOSED)
+		word |= INTERLOCK_ROOF_CLOSED;
+	
+	uint32_t changed = word ^ interlockWord;
+	interlockWord = word;
+	
+	if (full) {
+		memset(interlockViolations, 0, sizeof(interlockViolations));
+		interlockBlocked[0] = interlockBlocked[1] = 0;
+		for (auto &rule : interlockRules) {
+			rule.satisfied = true;
+			setInterlockRule(rule, (word & rule.mask) == rule.value);
+		}
+		return;
+	}
+	
+	if (changed == 0)
+		return;
+	for (auto &rule : interlockRules)
+		if (rule.mask & changed)
+			setInterlockRule(rule, (word & rule.mask) == rule.value);
+}
+
+//////////////////////////////////////
+/* setInterlockRule */
+// Keep interlockBlocked consistent with the number of violated rules per target and command
+void Ipx800::setInterlockRule(InterlockRule &rule, bool satisfied)
+{
+	if (satisfied == rule.satisfied)
+		return;
+	
+	uint8_t &violations = interlockViolations[rule.command][rule.target];
+	if (satisfied)
+		violations--;
+	else
+		violations++;
+	rule.satisfied = satisfied;
+	LOGF_DEBUG("Interlock \"%s\" %s", rule.text.c_str(), satisfied ? "satisfied" : "violated");
+	
+	if (violations > 0)
+		interlockBlocked[rule.command] |= 1u << rule.target;
+	else
+		interlockBlocked[rule.command] &= ~(1u << rule.target);
+}
+
+//////////////////////////////////////
+/* compilePowerSequence */
+// Steps are separated by ';' : FUNCTION[@settle_ms] [after FUNCTION[, FUNCTION...]] [confirm DIGITAL_FUNCTION]
+// FUNCTION is a relay function. A step can only depend on steps listed before it,
+// so the dependency graph has no cycle.
+bool Ipx800::compilePowerSequence(const char *sequence)
+{
+	std::vector<PowerStep> compiled;
+	std::string text = sequence ? sequence : "";
+	
+	size_t start = 0;
+	while (start < text.size()) {
+		size_t end = text.find(';', start);
+		if (end == std::string::npos)
+			end = text.size();
+		std::string stepText = trimToken(text.substr(start, end - start));
+		start = end + 1;
+		if (stepText.empty())
+			continue;
+		if (compiled.size() >= 32) {
+			LOG_ERROR("Power sequence : 32 steps maximum");
+			return false;
+		}
 		
-		currentDIndex = IUFindOnSwitchIndex(&DigitalInputSP[i]);
-		if (currentDIndex != -1) {
-			Digital_Fonction_Tab [currentDIndex] = i;
-			LOGF_DEBUG("firstFonctionTabInit - Digital Input %d is supporting function %d ",i+1, currentDIndex);
-			currentDIndex = -1;
-			//if (currentDIndex >0)
-			//	cptD = cptD +1;
+		PowerStep step { 0, 0, 0, 0, 0, STEP_DONE, 0 };
+		size_t confirm = stepText.find(" confirm ");
+		if (confirm != std::string::npos) {
+			step.confirm = findFunction(DigitalFunctionNames, 10, trimToken(stepText.substr(confirm + 9)));
+			if (step.confirm < 0) {
+				LOGF_ERROR("Power sequence step \"%s\" : unknown confirmation input", stepText.c_str());
+				return false;
 			}
-		else
-			LOGF_DEBUG("firstFonctionTabInit - Function unknown for Digital Input %d", i+1);
+			stepText = stepText.substr(0, confirm);
+		}
+		size_t after = stepText.find(" after ");
+		if (after != std::string::npos) {
+			std::string depends = stepText.substr(after + 7);
+			stepText = stepText.substr(0, after);
+			size_t dStart = 0;
+			while (dStart <= depends.size()) {
+				size_t dEnd = depends.find(',', dStart);
+				if (dEnd == std::string::npos)
+					dEnd = depends.size();
+				int fonction = findFunction(RelayFunctionNames, 11, trimToken(depends.substr(dStart, dEnd - dStart)));
+				size_t j = 0;
+				while (j < compiled.size() && compiled[j].fonction != fonction)
+					j++;
+				if (fonction < 0 || j == compiled.size()) {
+					LOGF_ERROR("Power sequence step \"%s\" : dependency must be a previous step", stepText.c_str());
+					return false;
+				}
+				step.depends |= 1u << j;
+				compiled[j].dependents |= 1u << compiled.size();
+				dStart = dEnd + 1;
+			}
+		}
+		size_t at = stepText.find('@');
+		if (at != std::string::npos) {
+			step.settleMs = strtoul(stepText.substr(at + 1).c_str(), nullptr, 10);
+			stepText = stepText.substr(0, at);
+		}
+		step.fonction = findFunction(RelayFunctionNames, 11, trimToken(stepText));
+		if (step.fonction < 0) {
+			LOGF_ERROR("Power sequence step \"%s\" : unknown relay function", stepText.c_str());
+			return false;
+		}
+		compiled.push_back(step);
 	}
 	
+	powerSteps.swap(compiled);
 	return true;
-}	
+}
+
+//////////////////////////////////////
+/* startPowerSequence */
+bool Ipx800::startPowerSequence(int sequence)
+{
+	if (!isConnected() || powerSteps.empty()) {
+		stopPowerSequence(IPS_ALERT, "No power sequence to run");
+		return false;
+	}
+	if (powerSequence != POWER_IDLE) {
+		LOG_WARN("Power sequence already running");
+		return false;
+	}
+	
+	for (auto &step : powerSteps)
+		step.state = STEP_WAITING;
+	powerSequence = sequence;
+	powerSequenceRun++;
+	powerSequenceStart = monotonicMs();
+	LOGF_INFO("Power %s started", sequence == POWER_STARTUP ? "startup" : "shutdown");
+	PowerSequenceSP.s = IPS_BUSY;
+	IDSetSwitch(&PowerSequenceSP, nullptr);
+	
+	runPowerSequence();
+	return true;
+}
+
+//////////////////////////////////////
+/* stopPowerSequence */
+void Ipx800::stopPowerSequence(IPState state, const char *message)
+{
+	powerSequence = POWER_IDLE;
+	// pending settle timers of this run are ignored
+	powerSequenceRun++;
+	IUResetSwitch(&PowerSequenceSP);
+	PowerSequenceSP.s = state;
+	if (message != nullptr)
+		IDSetSwitch(&PowerSequenceSP, "%s", message);
+}
+
+//////////////////////////////////////
+/* runPowerSequence */
+// Every step whose dependencies are done is started in the same batch, then a
+// single relay status refresh is done. Startup waits for dependencies, shutdown
+// for dependents. Called again when a settle delay ends and on each snapshot.
+void Ipx800::runPowerSequence()
+{
+	if (powerSequence == POWER_IDLE)
+		return;
+	
+	bool startup = (powerSequence == POWER_STARTUP);
+	uint64_t now = monotonicMs();
+	uint32_t done = 0;
+	bool sent = false;
+	bool progress = true;
+	
+	// completed steps first : at shutdown, a step waits for the steps after it
+	for (size_t i=0;i<powerSteps.size();i++) {
+		PowerStep &step = powerSteps[i];
+		if (step.state == STEP_CONFIRMING) {
+			int digit = digitalForFunction(step.confirm);
+			if (digit >= 0 && digitalState[digit])
+				step.state = STEP_DONE;
+			else if (now - step.startedAt > POWER_CONFIRM_TIMEOUT) {
+				LOGF_ERROR("Power sequence : no confirmation from %s", DigitalFunctionNames[step.confirm]);
+				stopPowerSequence(IPS_ALERT, "Power sequence failed");
+				return;
+			}
+		}
+		if (step.state == STEP_DONE)
+			done |= 1u << i;
+	}
+	
+	// then every step whose dependencies are done, again while skipped steps complete some
+	while (progress) {
+		progress = false;
+		for (size_t i=0;i<powerSteps.size();i++) {
+			PowerStep &step = powerSteps[i];
+			if (step.state != STEP_WAITING || ((startup ? step.depends : step.dependents) & ~done))
+				continue;
+			
+			int relay = relayForFunction(step.fonction);
+			if (relay < 0) {
+				LOGF_WARN("Power sequence : no relay in charge of %s, step skipped", RelayFunctionNames[step.fonction]);
+				step.state = STEP_DONE;
+				done |= 1u << i;
+				progress = true;
+				continue;
+			}
+			if (!CommandOutput(relay, startup ? INDI::OutputInterface::On : INDI::OutputInterface::Off, EventLog::CAUSE_SEQUENCE)) {
+				stopPowerSequence(IPS_ALERT, "Power sequence failed");
+				return;
+			}
+			sent = true;
+			step.state = STEP_SETTLING;
+			step.startedAt = now;
+			int settleID = relayTimers.schedule(step.settleMs, [this, i, startup, run = powerSequenceRun]() {
+				if (run != powerSequenceRun)
+					return;
+				powerSteps[i].state = (startup && powerSteps[i].confirm > 0) ? STEP_CONFIRMING : STEP_DONE;
+				powerSteps[i].startedAt = monotonicMs();
+				runPowerSequence();
+			});
+			// without its timer, the step would settle forever
+			if (settleID < 0) {
+				LOGF_ERROR("Power sequence : %s settling can't be timed", RelayFunctionNames[step.fonction]);
+				stopPowerSequence(IPS_ALERT, "Power sequence failed");
+				return;
+			}
+		}
+	}
+	
+	if (sent)
+		UpdateDigitalOutputs();
+	
+	if (done == ((powerSteps.size() == 32) ? 0xFFFFFFFFu : ((1u << powerSteps.size()) - 1))) {
+		char message[64];
+		snprintf(message, sizeof(message), "Power %s complete in %.1f s", startup ? "startup" : "shutdown",
+				 (now - powerSequenceStart) / 1000.0);
+		LOGF_INFO("%s", message);
+		stopPowerSequence(IPS_OK, message);
+	}
+}
+
+//////////////////////////////////////
+/* startRoofMotion */
+// Roof control command pulsed, as seen by a single button (toggle) controller : a moving roof
+// stops, a stopped roof runs away from its limit switch, or the other way than its last run
+void Ipx800::startRoofMotion(bool commanded)
+{
+	if (commanded && Roof_Motion != ROOF_STOPPED) {
+		// stopped between its limit switches
+		Roof_Motion = ROOF_STOPPED;
+		Roof_Status = UNKNOWN_STATUS;
+		roofRunStart = 0;
+		publishRoofStatus();
+		return;
+	}
+	
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	MotionStart.tv_sec = now.tv_sec;
+	MotionStart.tv_usec = now.tv_nsec / 1000;
+	// only runs from a command and a known limit switch are timed
+	bool fromLimit = Roof_Status == ROOF_IS_CLOSED || Roof_Status == ROOF_IS_OPENED;
+	roofRunStart = commanded && fromLimit ? monotonicMs() : 0;
+	
+	if (Roof_Status == ROOF_IS_CLOSED)
+		Roof_Motion = ROOF_OPENING;
+	else if (Roof_Status == ROOF_IS_OPENED)
+		Roof_Motion = ROOF_CLOSING;
+	else if (roofLastMotion == ROOF_OPENING)
+		Roof_Motion = ROOF_CLOSING;
+	else if (roofLastMotion == ROOF_CLOSING)
+		Roof_Motion = ROOF_OPENING;
+	else
+		Roof_Motion = ROOF_MOVING;
+	roofLastMotion = Roof_Motion;
+	roofFault = false;
+	
+	// Next snapshot at motion polling rate
+	if (isConnected()) {
+		RemoveTimer(PollTimerID);
+		PollTimerID = SetTimer(ROOF_MOTION_POLLING_TIMER);
+	}
+	publishRoofStatus();
+}
+
+//////////////////////////////////////
+/* recordRoofRun */
+// Roof run completed at the limit switch edge : compared with the runs learned so far,
+// then learned itself
+void Ipx800::recordRoofRun(int direction, uint64_t endMs)
+{
+	if (roofRunStart == 0 || endMs < roofRunStart)
+		return;
+	uint32_t ms = static_cast<uint32_t>(endMs - roofRunStart);
+	roofRunStart = 0;
+	
+	const char *run = direction == RoofRuns::OPEN ? "opening" : "closing";
+	uint32_t limit = roofRuns.percentile(direction, RoofRunAlertN[0].value);
+	bool slow = roofRuns.size(direction) >= RoofRunAlertN[1].value && ms > limit;
+	if (slow)
+		LOGF_WARN("Roof %s took %.1f s, slower than %.0f %% of the last runs (%.1f s) : check engine and rails",
+		          run, ms / 1000.0, RoofRunAlertN[0].value, limit / 1000.0);
+	if (!roofRuns.record(direction, ms))
+		LOGF_DEBUG("Roof %s run not saved", run);
+	publishRoofRuns(slow);
+}
+
+//////////////////////////////////////
+/* publishRoofRuns */
+void Ipx800::publishRoofRuns(bool slow)
+{
+	for (int direction=0; direction<RoofRuns::DIRECTIONS; direction++) {
+		RoofRunsN[3*direction].value = roofRuns.last(direction) / 1000.0;
+		RoofRunsN[3*direction+1].value = roofRuns.percentile(direction, RoofRunAlertN[0].value) / 1000.0;
+		RoofRunsN[3*direction+2].value = roofRuns.trend(direction) * 10 / 1000.0;
+	}
+	RoofRunsNP.s = slow ? IPS_ALERT : IPS_OK;
+	if (isConnected())
+		IDSetNumber(&RoofRunsNP, nullptr);
+}
+
+//////////////////////////////////////
+/* cutRoofPower */
+void Ipx800::cutRoofPower(const char *reason)
+{
+	int powerRelay = relayForFunction(ROOF_ENGINE_POWER_SUPPLY);
+	
+	if (powerRelay < 0) {
+		LOGF_ERROR("Roof fault : %s. No relay in charge of roof engine power, can't cut it !", reason);
+		return;
+	}
+	LOGF_ERROR("Roof fault : %s. Cutting roof engine power (relay %d)", reason, powerRelay+1);
+	if (relayState[powerRelay]) {
+		bool rc = writeCommand(ClearR, powerRelay+1);
+		if (rc)
+			readAnswer();
+		eventLog.record(monotonicMs(), EventLog::EV_COMMAND, powerRelay, EventLog::CAUSE_ROOF, INDI::OutputInterface::Off,
+		                rc ? EventLog::OUTCOME_DONE : EventLog::OUTCOME_FAILED);
+		relayState[powerRelay] = false;
+	}
+}
+
+//////////////////////////////////////
+/* publishRoofStatus */
+void Ipx800::publishRoofStatus()
+{
+	RoofStatusL[0].s = (Roof_Status == ROOF_IS_OPENED) ? IPS_OK : IPS_IDLE;
+	RoofStatusL[1].s = (Roof_Status == ROOF_IS_CLOSED) ? IPS_OK : IPS_IDLE;
+	RoofStatusL[2].s = (Roof_Motion != ROOF_STOPPED) ? IPS_BUSY : IPS_IDLE;
+	RoofStatusL[3].s = roofFault ? IPS_ALERT : IPS_IDLE;
+	RoofStatusLP.s = roofFault ? IPS_ALERT : ((Roof_Motion != ROOF_STOPPED) ? IPS_BUSY : IPS_OK);
+	IDSetLight(&RoofStatusLP, nullptr);
+	
+	if (Roof_Motion != ROOF_STOPPED) {
+		RoofTimeLeftN[0].value = std::max(0.0f, CalcTimeLeft(MotionStart));
+		RoofTimeLeftNP.s = IPS_BUSY;
+	}
+	else {
+		RoofTimeLeftN[0].value = 0;
+		RoofTimeLeftNP.s = roofFault ? IPS_ALERT : IPS_IDLE;
+	}
+	publishLimited(LIMITED_ROOF_MOTION, RoofTimeLeftNP.s, [this]() { IDSetNumber(&RoofTimeLeftNP, nullptr); });
+	
+	if (!domeInterface)
+		return;
+	
+	// Dome parking follows the limit switches
+	IPState domeState = roofFault ? IPS_ALERT : ((Roof_Motion != ROOF_STOPPED) ? IPS_BUSY : IPS_OK);
+	if (Roof_Motion == ROOF_STOPPED) {
+		IUResetSwitch(&DomeMotionSP);
+		DomeParkS[0].s = (Roof_Status == ROOF_IS_CLOSED) ? ISS_ON : ISS_OFF;
+		DomeParkS[1].s = (Roof_Status == ROOF_IS_OPENED) ? ISS_ON : ISS_OFF;
+	}
+	if (DomeMotionSP.s != domeState) {
+		DomeMotionSP.s = domeState;
+		IDSetSwitch(&DomeMotionSP, nullptr);
+	}
+	DomeParkSP.s = domeState;
+	IDSetSwitch(&DomeParkSP, nullptr);
+}
+
+//////////////////////////////////////
+/* updateDomeInterface */
+// Announce Dome interface to clients, so that no "Universal ROR" driver is needed
+void Ipx800::updateDomeInterface()
+{
+	uint32_t driverInterface = AUX_INTERFACE | INPUT_INTERFACE | OUTPUT_INTERFACE;
+	if (domeInterface)
+		driverInterface |= DOME_INTERFACE;
+	setDriverInterface(driverInterface);
+	syncDriverInfo();
+}
+
+//////////////////////////////////////
+/* publishLimited */
+// send() publishes the current values of the property : a held back update is only delayed,
+// and the flush sends whatever is latest by then
+void Ipx800::publishLimited(int property, IPState state, TimerWheel::Action send)
+{
+	// analog inputs share the first interval, then one per property, in enum order
+	static_assert(LIMITED_ANALOG == 0 && LIMITED_PROPERTIES - LIMITED_ANALOG_STATS + 1 ==
+	              sizeof(UpdateIntervalN) / sizeof(UpdateIntervalN[0]), "one Client Updates interval per limited property");
+	int intervalIndex = property < LIMITED_ANALOG_STATS ? 0 : property - LIMITED_ANALOG_STATS + 1;
+	RateLimit &limit = rateLimits[property];
+	uint64_t interval = static_cast<uint64_t>(UpdateIntervalN[intervalIndex].value);
+	uint64_t now = monotonicMs();
+	
+	if (interval == 0 || state == IPS_ALERT || state != limit.lastState || now - limit.lastSent >= interval) {
+		if (limit.flushID >= 0)
+			relayTimers.cancel(limit.flushID);
+		limit.flushID = -1;
+		limit.lastSent = now;
+		limit.lastState = state;
+		send();
+		return;
+	}
+	if (limit.flushID >= 0)
+		return;
+	limit.flushID = relayTimers.schedule(limit.lastSent + interval - now, [this, property, send]() {
+		rateLimits[property].flushID = -1;
+		rateLimits[property].lastSent = monotonicMs();
+		send();
+	});
+	// without timers, nothing may be held back
+	if (limit.flushID < 0) {
+		limit.lastSent = now;
+		send();
+	}
+}
+
+//////////////////////////////////////
+/* moveRoof */
+// Pulse ROOF_CONTROL_COMMAND unless the roof is already at, or moving to, roofTarget.
+// A roof running the other way is stopped by the pulse, then pulsed again once settled.
+bool Ipx800::moveRoof(int roofTarget)
+{
+	int commandRelay = relayForFunction(ROOF_CONTROL_COMMAND);
+	
+	if (commandRelay < 0) {
+		LOG_ERROR("No relay in charge of roof control command");
+		return false;
+	}
+	if (Roof_Motion == ROOF_STOPPED && Roof_Status == roofTarget) {
+		LOGF_INFO("Roof already %s", roofTarget == ROOF_IS_OPENED ? "opened" : "closed");
+		return true;
+	}
+	if ((roofTarget == ROOF_IS_OPENED && Roof_Motion == ROOF_OPENING) ||
+		(roofTarget == ROOF_IS_CLOSED && Roof_Motion == ROOF_CLOSING))
+		return true;
+	if (Roof_Motion == ROOF_MOVING) {
+		// a pulse would only stop it, and the next one run it in an unknown direction
+		LOG_WARN("Roof moving in an unknown direction : wait for a limit switch, or abort");
+		return false;
+	}
+	if (roofPulseTimerID != -1 || roofReverseTimerID != -1) {
+		LOG_WARN("Roof command pulse already in progress");
+		return false;
+	}
+	
+	LOGF_INFO("Roof %s requested", roofTarget == ROOF_IS_OPENED ? "opening" : "closing");
+	if (!CommandOutput(commandRelay, INDI::OutputInterface::On, EventLog::CAUSE_ROOF))
+		return false;
+	
+	roofPulseTimerID = relayTimers.schedule(ROOF_COMMAND_PULSE, [this, commandRelay]() {
+		roofPulseTimerID = -1;
+		CommandOutput(commandRelay, INDI::OutputInterface::Off, EventLog::CAUSE_ROOF);
+	});
+	if (Roof_Motion == ROOF_STOPPED) {
+		LOGF_INFO("Roof stopped, %s in %.1f s", roofTarget == ROOF_IS_OPENED ? "opening" : "closing",
+		          (ROOF_COMMAND_PULSE + ROOF_STOP_SETTLE) / 1000.0);
+		roofReverseTimerID = relayTimers.schedule(ROOF_COMMAND_PULSE + ROOF_STOP_SETTLE, [this, roofTarget]() {
+			roofReverseTimerID = -1;
+			moveRoof(roofTarget);
+		});
+	}
+	return true;
+}
+
+//////////////////////////////////////
+/* expireRelayTimers */
+void Ipx800::expireRelayTimers()
+{
+	relayTimers.expire();
+}
+
+//////////////////////////////////////
+/* pulseRelay */
+// relay On now, Off after durationMs
+bool Ipx800::pulseRelay(int relay, uint32_t durationMs)
+{
+	if (relay < 0 || relay >= relayCount || !isConnected())
+		return false;
+	if (!CommandOutput(relay, INDI::OutputInterface::On, EventLog::CAUSE_TIMER))
+		return false;
+	
+	// a new pulse on the same relay restarts the duration
+	LOGF_DEBUG("pulseRelay - Relay %d for %u ms", relay+1, durationMs);
+	relayTimers.cancel(relayPulseID[relay]);
+	relayPulseID[relay] = relayTimers.schedule(durationMs, [this, relay]() {
+		relayPulseID[relay] = -1;
+		CommandOutput(relay, INDI::OutputInterface::Off, EventLog::CAUSE_TIMER);
+		RelayPulseNP.s = IPS_OK;
+		IDSetNumber(&RelayPulseNP, nullptr);
+	});
+	return relayPulseID[relay] >= 0;
+}
+
+//////////////////////////////////////
+/* delayRelay */
+// command sent to relay after delayMs
+bool Ipx800::delayRelay(int relay, uint32_t delayMs, OutputState command)
+{
+	if (relay < 0 || relay >= relayCount || !isConnected())
+		return false;
+	
+	LOGF_DEBUG("delayRelay - Relay %d %s in %u ms", relay+1, command == INDI::OutputInterface::On ? "ON" : "OFF", delayMs);
+	return relayTimers.schedule(delayMs, [this, relay, command]() {
+		RelayDelayNP.s = CommandOutput(relay, command, EventLog::CAUSE_TIMER) ? IPS_OK : IPS_ALERT;
+		IDSetNumber(&RelayDelayNP, nullptr);
+	}) >= 0;
+}
+
+//////////////////////////////////////
+/* prepareWeatherClose */
+// M2M commands of the weather close path are built in advance, when relays functions change
+void Ipx800::prepareWeatherClose()
+{
+	int commandRelay = relayForFunction(ROOF_CONTROL_COMMAND);
+	int powerRelay = relayForFunction(ROOF_ENGINE_POWER_SUPPLY);
+	
+	weatherCloseRelay = commandRelay;
+	weatherPowerRelay = powerRelay;
+	weatherCloseCommand[0] = weatherPowerCommand[0] = '\0';
+	if (protocol->setRelay == nullptr) {
+		// no relay command in this generation : nothing can be prepared
+		weatherCloseRelay = weatherPowerRelay = -1;
+		if (weatherClose)
+			LOGF_WARN("Close roof on weather alert enabled, but IPX800 V%d relays can't be commanded", protocol->version);
+		return;
+	}
+	if (commandRelay >= 0)
+		snprintf(weatherCloseCommand, sizeof(weatherCloseCommand), protocol->setRelay, commandRelay+1);
+	if (powerRelay >= 0)
+		snprintf(weatherPowerCommand, sizeof(weatherPowerCommand), protocol->setRelay, powerRelay+1);
+	if (weatherClose && commandRelay < 0)
+		LOG_WARN("Close roof on weather alert enabled, but no relay in charge of roof control command");
+}
+
+//////////////////////////////////////
+/* weatherCloseRoof */
+// High priority path : prepared commands are written straight to the IPX800,
+// from the snoop event, without waiting for any client or polling cycle.
+// Weather drivers send Alert again at each poll : once the roof is closing, no other pulse is
+// sent until it is seen closed or the alert clears (a toggle controller would stop the roof).
+// A roof opening is stopped first, then pulsed again once settled.
+void Ipx800::weatherCloseRoof()
+{
+	if (!isConnected() || weatherCloseRelay < 0 || weatherCloseIssued || roofReverseTimerID >= 0)
+		return;
+	if (Roof_Motion == ROOF_CLOSING || (Roof_Motion == ROOF_STOPPED && Roof_Status == ROOF_IS_CLOSED))
+		return;
+	if (Roof_Motion == ROOF_MOVING) {
+		// closed from the next Alert after a limit switch is reached
+		IPX_LOG_ERROR_LIMITED("Weather alert : roof moving in an unknown direction, waiting for a limit switch");
+		return;
+	}
+	if (interlockBlocked[INDI::OutputInterface::On] & (1u << ROOF_CONTROL_COMMAND)) {
+		LOG_ERROR("Weather alert : roof closing refused by interlocks");
+		return;
+	}
+	
+	if (weatherPowerRelay >= 0 && !relayState[weatherPowerRelay]) {
+		bool rc = writeTCP(weatherPowerCommand);
+		if (rc)
+			readAnswer();
+		eventLog.record(monotonicMs(), EventLog::EV_COMMAND, weatherPowerRelay, EventLog::CAUSE_WEATHER, INDI::OutputInterface::On,
+		                rc ? EventLog::OUTCOME_DONE : EventLog::OUTCOME_FAILED);
+		if (rc)
+			relayState[weatherPowerRelay] = true;
+	}
+	if (!writeTCP(weatherCloseCommand)) {
+		eventLog.record(monotonicMs(), EventLog::EV_COMMAND, weatherCloseRelay, EventLog::CAUSE_WEATHER, INDI::OutputInterface::On,
+		                EventLog::OUTCOME_FAILED);
+		LOG_ERROR("Weather alert : roof close command failed");
+		return;
+	}
+	readAnswer();
+	eventLog.record(monotonicMs(), EventLog::EV_COMMAND, weatherCloseRelay, EventLog::CAUSE_WEATHER, INDI::OutputInterface::On,
+	                EventLog::OUTCOME_DONE);
+	startRoofMotion();
+	
+	int commandRelay = weatherCloseRelay;
+	relayTimers.cancel(roofPulseTimerID);
+	roofPulseTimerID = relayTimers.schedule(ROOF_COMMAND_PULSE, [this, commandRelay]() {
+		roofPulseTimerID = -1;
+		CommandOutput(commandRelay, INDI::OutputInterface::Off, EventLog::CAUSE_WEATHER);
+	});
+	
+	if (Roof_Motion == ROOF_CLOSING) {
+		LOG_WARN("Weather alert : roof close command sent");
+		weatherCloseIssued = true;
+	}
+	else if (Roof_Motion == ROOF_STOPPED) {
+		// the pulse stopped a roof opening : the next one closes it
+		LOG_WARN("Weather alert : roof stopped, closing it");
+		roofReverseTimerID = relayTimers.schedule(ROOF_COMMAND_PULSE + ROOF_STOP_SETTLE, [this]() {
+			roofReverseTimerID = -1;
+			if (weatherAlert)
+				weatherCloseRoof();
+		});
+	}
+	else
+		LOG_WARN("Weather alert : roof pulsed from an unknown position, closed once a limit switch is reached");
+}
+
+//////////////////////////////////////
+/* updateDewPoint */
+// Heater power from the last weather values : full at or below the full power margin,
+// none above the off margin, linear in between
+void Ipx800::updateDewPoint()
+{
+	if (std::isnan(dewTemperature) || std::isnan(dewHumidity))
+		return;
+	
+	// Magnus formula (Sonntag coefficients), within 0.4 °C from -45 to 60 °C
+	const double b = 17.62, c = 243.12;
+	double humidity = std::min(std::max(dewHumidity, 1.0), 100.0);
+	double gamma = std::log(humidity / 100.0) + b * dewTemperature / (c + dewTemperature);
+	double dewPoint = c * gamma / (b - gamma);
+	double margin = dewTemperature - dewPoint;
+	double full = DewSettingsN[DEW_FULL_MARGIN].value, off = DewSettingsN[DEW_OFF_MARGIN].value;
+	
+	if (margin <= full)
+		dewPower = 1;
+	else if (margin >= off)
+		dewPower = 0;
+	else
+		dewPower = (off - margin) / (off - full);
+	dewDataAt = monotonicMs();
+	
+	DewStatusN[DEW_TEMPERATURE].value = dewTemperature;
+	DewStatusN[DEW_HUMIDITY].value = dewHumidity;
+	DewStatusN[DEW_POINT].value = dewPoint;
+	DewStatusN[DEW_MARGIN].value = margin;
+	DewStatusN[DEW_POWER].value = dewPower * 100.0;
+	DewStatusNP.s = IPS_OK;
+	if (isConnected())
+		IDSetNumber(&DewStatusNP, nullptr);
+}
+
+//////////////////////////////////////
+/* runDewHeater */
+// After each successful poll : heaters on for power * period at the start of each PWM period.
+// Neither pulse nor gap is shorter than the min pulse, and a command is only sent when
+// the budget allows it, otherwise at a later poll.
+void Ipx800::runDewHeater()
+{
+	if (!dewHeater)
+		return;
+	uint64_t now = monotonicMs();
+	
+	// budget refilled continuously, one minute of commands at most
+	double perMinute = DewSettingsN[DEW_MAX_COMMANDS].value;
+	dewTokens = std::min(perMinute, dewTokens + (now - dewTokensAt) * perMinute / 60000.0);
+	dewTokensAt = now;
+	
+	// no weather values for too long : heaters off
+	double power = dewPower;
+	if (dewDataAt == 0 || now - dewDataAt > DEW_DATA_TIMEOUT) {
+		power = 0;
+		if (DewStatusNP.s != IPS_ALERT && isConnected()) {
+			DewStatusN[DEW_POWER].value = 0;
+			DewStatusNP.s = IPS_ALERT;
+			IDSetNumber(&DewStatusNP, "Dew heater : no weather values from %s", DewSnoopT[0].text);
+		}
+	}
+	
+	uint64_t period = static_cast<uint64_t>(DewSettingsN[DEW_PERIOD].value * 1000);
+	uint64_t minPulse = static_cast<uint64_t>(DewSettingsN[DEW_MIN_PULSE].value * 1000);
+	if (dewPeriodStart == 0 || now - dewPeriodStart >= period)
+		dewPeriodStart = now;
+	uint64_t onTime = static_cast<uint64_t>(power * period);
+	if (onTime < minPulse)
+		onTime = 0;
+	else if (period - onTime < minPulse)
+		onTime = period;
+	bool on = now - dewPeriodStart < onTime;
+	
+	for (int fonction : {HEATING_RESISTOR_1, HEATING_RESISTOR_2}) {
+		int relay = relayForFunction(fonction);
+		if (relay < 0 || relayState[relay] == on)
+			continue;
+		if (dewTokens < 1) {
+			LOGF_DEBUG("Dew heater : relay %d command deferred, budget reached", relay+1);
+			continue;
+		}
+		dewTokens -= 1;
+		if (CommandOutput(relay, on ? INDI::OutputInterface::On : INDI::OutputInterface::Off, EventLog::CAUSE_DEW))
+			relayState[relay] = on;
+	}
+}
+
+//////////////////////////////////////
+/* stopDewHeater */
+// Heaters switched off when the controller is disabled or the connection closed
+void Ipx800::stopDewHeater()
+{
+	for (int fonction : {HEATING_RESISTOR_1, HEATING_RESISTOR_2}) {
+		int relay = relayForFunction(fonction);
+		if (relay >= 0 && relayState[relay] && isConnected()
+		    && CommandOutput(relay, INDI::OutputInterface::Off, EventLog::CAUSE_DEW))
+			relayState[relay] = false;
+	}
+}
+
+//////////////////////////////////////
+/* abortRoof */
+// Stop the roof by removing engine power
+bool Ipx800::abortRoof()
+{
+	int powerRelay = relayForFunction(ROOF_ENGINE_POWER_SUPPLY);
+	
+	if (powerRelay < 0) {
+		LOG_ERROR("Abort impossible : no relay in charge of roof engine power");
+		return false;
+	}
+	// a safety cut : sent directly, interlocks can't refuse it
+	LOG_WARN("Roof motion aborted, cutting roof engine power");
+	bool rc = writeCommand(ClearR, powerRelay+1);
+	if (rc)
+		readAnswer();
+	eventLog.record(monotonicMs(), EventLog::EV_COMMAND, powerRelay, EventLog::CAUSE_ROOF, INDI::OutputInterface::Off,
+	                rc ? EventLog::OUTCOME_DONE : EventLog::OUTCOME_FAILED);
+	if (!rc) {
+		LOG_ERROR("Roof engine power cut failed");
+		return false;
+	}
+	relayState[powerRelay] = false;
+	// a pending reversal would start the roof again
+	relayTimers.cancel(roofReverseTimerID);
+	roofReverseTimerID = -1;
+	Roof_Motion = ROOF_STOPPED;
+	publishRoofStatus();
+	return true;
+}
+
+//////////////////////////////////////
+/* CalcTimeLeft */
+// Remaining time (s) before roof travel timeout, from a CLOCK_MONOTONIC start
+float Ipx800::CalcTimeLeft(timeval start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	double timesince = (now.tv_sec - start.tv_sec) + (now.tv_nsec / 1000 - start.tv_usec) / 1e6;
+	return static_cast<float>(MotionRequest - timesince);
+}
+
+//////////////////////////////////////
+/* buildFunctionIndex */
+// Function <-> channel index built again from the function switches, once the saved channel
+// settings are loaded by setChannelCounts. Later selections (and Load config) go through assignFunction
+void Ipx800::buildFunctionIndex()
+{
+	for (int kind=0; kind<CHANNEL_KINDS; kind++) {
+		std::fill(std::begin(functionChannel[kind]), std::end(functionChannel[kind]), -1);
+		channelFunction[kind].assign(channelCount[kind], 0);
+		for (int i=0; i<channelCount[kind]; i++) {
+			int fonction = IUFindOnSwitchIndex(&channelConfigSP[kind][i]);
+			if (fonction != -1) {
+				assignFunction(kind, i, fonction);
+				LOGF_DEBUG("buildFunctionIndex - %s is supporting function %d", channelConfigSP[kind][i].label, fonction);
+			}
+			else
+				LOGF_DEBUG("buildFunctionIndex - Function unknown for %s", channelConfigSP[kind][i].label);
+		}
+	}
+}
+
+//////////////////////////////////////
+/* assignFunction */
+// Index update after a function selection. The function released by the channel goes back
+// to another channel still selecting it, if any : the last selection wins.
+void Ipx800::assignFunction(int kind, int channel, int fonction)
+{
+	int previous = channelFunction[kind][channel];
+	channelFunction[kind][channel] = fonction;
+	if (previous > 0 && functionChannel[kind][previous] == channel) {
+		functionChannel[kind][previous] = -1;
+		for (int i=0; i<channelCount[kind]; i++)
+			if (channelFunction[kind][i] == previous) {
+				functionChannel[kind][previous] = i;
+				break;
+			}
+	}
+	if (fonction > 0) {
+		int holder = functionChannel[kind][fonction];
+		if (holder >= 0 && holder != channel)
+			LOGF_WARN("%s is selected by %s and %s, the latter is used", channelKinds[kind].functionNames[fonction],
+			          channelConfigSP[kind][holder].label, channelConfigSP[kind][channel].label);
+		functionChannel[kind][fonction] = channel;
+	}
+	
+	if (kind == DIGITAL_CHANNELS) {
+		reversedDigitals = 0;
+		for (int reversed : {ROOF_ENGINE_POWERED, RASPBERRY_SUPPLIED, MAIN_PC_SUPPLIED})
+			if (functionChannel[kind][reversed] >= 0)
+				reversedDigitals |= 1ull << functionChannel[kind][reversed];
+	}
+}
+
+//////////////////////////////////////
+/* buildChannels */
+// Sizes every per channel structure, and fills the properties of added channels
+void Ipx800::buildChannels(int relays, int digitals)
+{
+	const int counts[CHANNEL_KINDS] = { relays, digitals };
+	
+	for (int kind=0; kind<CHANNEL_KINDS; kind++) {
+		const ChannelKind &k = channelKinds[kind];
+		int added = channelCount[kind];
+		for (int i=counts[kind]; i<added; i++)
+			free(channelFunctionT[kind][i].text);
+		channelConfigS[kind].resize(counts[kind] * k.functions);
+		channelConfigSP[kind].resize(counts[kind]);
+		channelStateS[kind].resize(counts[kind] * 2);
+		channelStateSP[kind].resize(counts[kind]);
+		channelFunctionT[kind].resize(counts[kind]);
+		channelStateL[kind].resize(counts[kind]);
+		channelFunction[kind].resize(counts[kind], 0);
+		
+		for (int i=added; i<counts[kind]; i++) {
+			char propName[MAXINDINAME], propLabel[MAXINDILABEL];
+			ISwitch *functions = &channelConfigS[kind][i * k.functions];
+			for (int f=0; f<k.functions; f++)
+				IUFillSwitch(&functions[f], k.functionLabels[f], "", f == 0 ? ISS_ON : ISS_OFF);
+			bool legacy = k.legacyConfigName != nullptr && i >= 3 && i < BASE_CHANNELS;
+			snprintf(propName, MAXINDINAME, legacy ? k.legacyConfigName : k.configName, i+1);
+			snprintf(propLabel, MAXINDILABEL, k.label, i+1);
+			IUFillSwitchVector(&channelConfigSP[kind][i], functions, k.functions, getDeviceName(), propName, propLabel,
+			                   k.configTab, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+			
+			ISwitch *states = &channelStateS[kind][i * 2];
+			IUFillSwitch(&states[0], "On", "ON", ISS_OFF);
+			IUFillSwitch(&states[1], "Off", "OFF", ISS_OFF);
+			snprintf(propName, MAXINDINAME, k.stateName, i+1);
+			IUFillSwitchVector(&channelStateSP[kind][i], states, 2, getDeviceName(), propName, propLabel, RAW_DATA_TAB,
+			                   IP_RO, ISR_1OFMANY, 60, IPS_IDLE);
+			
+			snprintf(propName, MAXINDINAME, "CHANNEL_%d", i+1);
+			IUFillText(&channelFunctionT[kind][i], propName, propLabel, "");
+			IUFillLight(&channelStateL[kind][i], propName, propLabel, IPS_IDLE);
+		}
+		IUFillTextVector(&channelFunctionTP[kind], channelFunctionT[kind].data(), counts[kind], getDeviceName(),
+		                 k.groupConfigName, k.groupLabel, k.configTab, IP_RW, 60, IPS_IDLE);
+		IUFillLightVector(&channelStateLP[kind], channelStateL[kind].data(), counts[kind], getDeviceName(),
+		                  k.groupStateName, k.groupLabel, RAW_DATA_TAB, IPS_IDLE);
+	}
+	
+	// Relay timers
+	relayState.resize(relays, false);
+	relayAutoOffID.resize(relays, -1);
+	relayPulseID.resize(relays, -1);
+	RelayAutoOffN.resize(relays);
+	for (int i=relayCount; i<relays; i++) {
+		char autoOffName[MAXINDINAME], autoOffLabel[MAXINDILABEL];
+		snprintf(autoOffName, MAXINDINAME, "AUTO_OFF_%d", i+1);
+		snprintf(autoOffLabel, MAXINDILABEL, "Relay %d (ms)", i+1);
+		IUFillNumber(&RelayAutoOffN[i], autoOffName, autoOffLabel, "%.0f", 0, 86400000, 1000, 0);
+	}
+	IUFillNumberVector(&RelayAutoOffNP, RelayAutoOffN.data(), relays, getDeviceName(), "RELAY_AUTO_OFF", "Auto Off (0 = never)",
+	                   RELAY_TIMERS_TAB, IP_RW, 0, IPS_IDLE);
+	
+	// Relays usage
+	RelayWattsN.resize(relays);
+	RelayUsageN.resize(relays * 4);
+	for (int i=relayCount; i<relays; i++) {
+		char usageName[MAXINDINAME], usageLabel[MAXINDILABEL];
+		snprintf(usageName, MAXINDINAME, "WATTS_%d", i+1);
+		snprintf(usageLabel, MAXINDILABEL, "Relay %d (W)", i+1);
+		IUFillNumber(&RelayWattsN[i], usageName, usageLabel, "%.0f", 0, 100000, 10, 0);
+		
+		snprintf(usageName, MAXINDINAME, "ON_HOURS_%d", i+1);
+		snprintf(usageLabel, MAXINDILABEL, "Relay %d on (h)", i+1);
+		IUFillNumber(&RelayUsageN[4*i], usageName, usageLabel, "%.2f", 0, 1e9, 0, 0);
+		snprintf(usageName, MAXINDINAME, "CYCLES_%d", i+1);
+		snprintf(usageLabel, MAXINDILABEL, "Relay %d cycles", i+1);
+		IUFillNumber(&RelayUsageN[4*i+1], usageName, usageLabel, "%.0f", 0, 1e12, 0, 0);
+		snprintf(usageName, MAXINDINAME, "ENERGY_%d", i+1);
+		snprintf(usageLabel, MAXINDILABEL, "Relay %d energy (kWh)", i+1);
+		IUFillNumber(&RelayUsageN[4*i+2], usageName, usageLabel, "%.3f", 0, 1e9, 0, 0);
+		snprintf(usageName, MAXINDINAME, "DUTY_%d", i+1);
+		snprintf(usageLabel, MAXINDILABEL, "Relay %d duty 24 h (%%)", i+1);
+		IUFillNumber(&RelayUsageN[4*i+3], usageName, usageLabel, "%.1f", 0, 100, 0, 0);
+	}
+	IUFillNumberVector(&RelayWattsNP, RelayWattsN.data(), relays, getDeviceName(), "RELAY_WATTS", "Power (0 = unknown)",
+	                   RELAY_USAGE_TAB, IP_RW, 0, IPS_IDLE);
+	IUFillNumberVector(&RelayUsageNP, RelayUsageN.data(), relays * 4, getDeviceName(), "RELAY_USAGE", "Usage",
+	                   RELAY_USAGE_TAB, IP_RO, 0, IPS_IDLE);
+	RelayPulseN[0].max = relays;
+	RelayDelayN[0].max = relays;
+	
+	// Digital inputs filter : transition accepted when stable for N samples and T ms
+	digitalState.resize(digitals, false);
+	digitalPendingCount.resize(digitals, 0);
+	digitalPendingSince.resize(digitals, 0);
+	digitalLastEdge.resize(digitals, 0);
+	DigitalFilterSamplesN.resize(digitals);
+	DigitalFilterTimeN.resize(digitals);
+	for (int i=digitalCount; i<digitals; i++) {
+		char filterName[MAXINDINAME], filterLabel[MAXINDILABEL];
+		snprintf(filterName, MAXINDINAME, "SAMPLES_%d", i+1);
+		snprintf(filterLabel, MAXINDILABEL, "Digital %d", i+1);
+		IUFillNumber(&DigitalFilterSamplesN[i], filterName, filterLabel, "%.0f", 1, 50, 1, 1);
+		snprintf(filterName, MAXINDINAME, "TIME_%d", i+1);
+		IUFillNumber(&DigitalFilterTimeN[i], filterName, filterLabel, "%.0f", 0, 60000, 10, 0);
+	}
+	IUFillNumberVector(&DigitalFilterSamplesNP, DigitalFilterSamplesN.data(), digitals, getDeviceName(), "DIGITAL_FILTER_SAMPLES",
+	                   "Stable Samples", DIGITAL_INPUT_CONFIGURATION_TAB, IP_RW, 0, IPS_IDLE);
+	IUFillNumberVector(&DigitalFilterTimeNP, DigitalFilterTimeN.data(), digitals, getDeviceName(), "DIGITAL_FILTER_TIME",
+	                   "Stable Time (ms)", DIGITAL_INPUT_CONFIGURATION_TAB, IP_RW, 0, IPS_IDLE);
+	
+	relayCount = relays;
+	digitalCount = digitals;
+}
+
+//////////////////////////////////////
+/* defineChannelProperties */
+// Functions (config) and / or states of every channel : one vector per channel, or one per group when compact
+void Ipx800::defineChannelProperties(bool config, bool states)
+{
+	for (int kind=0; kind<CHANNEL_KINDS; kind++) {
+		if (config && compactPublication)
+			defineProperty(&channelFunctionTP[kind]);
+		else if (config)
+			for (int i=0; i<channelCount[kind]; i++)
+				defineProperty(&channelConfigSP[kind][i]);
+		if (states && compactPublication)
+			defineProperty(&channelStateLP[kind]);
+		else if (states)
+			for (int i=0; i<channelCount[kind]; i++)
+				defineProperty(&channelStateSP[kind][i]);
+	}
+}
+
+//////////////////////////////////////
+/* deleteChannelProperties */
+void Ipx800::deleteChannelProperties(bool config, bool states)
+{
+	for (int kind=0; kind<CHANNEL_KINDS; kind++) {
+		if (config && compactPublication)
+			deleteProperty(channelFunctionTP[kind].name);
+		else if (config)
+			for (int i=0; i<channelCount[kind]; i++)
+				deleteProperty(channelConfigSP[kind][i].name);
+		if (states && compactPublication)
+			deleteProperty(channelStateLP[kind].name);
+		else if (states)
+			for (int i=0; i<channelCount[kind]; i++)
+				deleteProperty(channelStateSP[kind][i].name);
+	}
+}
+
+//////////////////////////////////////
+/* defineTabs */
+// Configuration (channel functions, digital filter, analog scaling) and diagnostic tabs
+void Ipx800::defineTabs(int tabs)
+{
+	if (tabs & CONFIGURATION_TABS) {
+		defineChannelProperties(true, false);
+		defineProperty(&DigitalFilterSamplesNP);
+		defineProperty(&DigitalFilterTimeNP);
+		defineProperty(&AnalogScaleNP);
+		defineProperty(&AnalogDeadbandNP);
+	}
+	if (tabs & DIAGNOSTIC_TABS) {
+		defineProperty(&M2MCaptureSP);
+		if (isConnected())
+			defineProperty(&AnalogStatsNP);
+	}
+}
+
+//////////////////////////////////////
+/* deleteTabs */
+void Ipx800::deleteTabs(int tabs)
+{
+	if (tabs & CONFIGURATION_TABS) {
+		deleteChannelProperties(true, false);
+		deleteProperty(DigitalFilterSamplesNP.name);
+		deleteProperty(DigitalFilterTimeNP.name);
+		deleteProperty(AnalogScaleNP.name);
+		deleteProperty(AnalogDeadbandNP.name);
+	}
+	if (tabs & DIAGNOSTIC_TABS) {
+		deleteProperty(M2MCaptureSP.name);
+		if (isConnected())
+			deleteProperty(AnalogStatsNP.name);
+	}
+}
+
+//////////////////////////////////////
+/* syncChannelFunction */
+// Function name of a channel in its group vector, after a selection
+void Ipx800::syncChannelFunction(int kind, int i)
+{
+	int fonction = IUFindOnSwitchIndex(&channelConfigSP[kind][i]);
+	IUSaveText(&channelFunctionT[kind][i], fonction > 0 ? channelKinds[kind].functionNames[fonction] : "");
+	if (compactPublication && (shownTabs & CONFIGURATION_TABS)) {
+		channelFunctionTP[kind].s = IPS_OK;
+		IDSetText(&channelFunctionTP[kind], nullptr);
+	}
+}
+
+//////////////////////////////////////
+/* setChannelCounts */
+// Channels reported by the IPX800 at Handshake : per channel properties are rebuilt when they differ
+void Ipx800::setChannelCounts(int relays, int digitals)
+{
+	// a bare IPX800 at least, and no more than asked in Options Tab
+	relays = std::min(std::max(relays, BASE_CHANNELS), MAX_CHANNELS);
+	digitals = std::min(std::max(digitals, BASE_CHANNELS), MAX_CHANNELS);
+	if (ChannelLimitN[0].value > 0)
+		relays = std::min(relays, static_cast<int>(ChannelLimitN[0].value));
+	if (ChannelLimitN[1].value > 0)
+		digitals = std::min(digitals, static_cast<int>(ChannelLimitN[1].value));
+	if (relays == relayCount && digitals == digitalCount)
+		return;
+	
+	LOGF_INFO("IPX800 with %d relays and %d digital inputs", relays, digitals);
+	if (staleState) {
+		// last known state was for other extensions : states are defined again once connected
+		deleteChannelProperties(false, true);
+		deleteProperty(RoofStatusLP.name);
+		deleteProperty(MountParkSP.name);
+		staleState = false;
+	}
+	deleteTabs(shownTabs & CONFIGURATION_TABS);
+	deleteProperty(RelayAutoOffNP.name);
+	deleteProperty(RelayWattsNP.name);
+	
+	int previousRelays = relayCount, previousDigitals = digitalCount;
+	buildChannels(relays, digitals);
+	
+	defineTabs(shownTabs & CONFIGURATION_TABS);
+	defineProperty(&RelayAutoOffNP);
+	defineProperty(&RelayWattsNP);
+	
+	// saved settings of added channels
+	for (int i=previousRelays;i<relayCount;i++)
+		loadConfig(true, RelaisInfoSP[i].name);
+	for (int i=previousDigitals;i<digitalCount;i++)
+		loadConfig(true, DigitalInputSP[i].name);
+	loadConfig(true, DigitalFilterSamplesNP.name);
+	loadConfig(true, DigitalFilterTimeNP.name);
+	loadConfig(true, RelayAutoOffNP.name);
+	loadConfig(true, RelayWattsNP.name);
+	// function switches restored : index built from them
+	buildFunctionIndex();
+	registerConfigItems();
+	
+	// Inputs / Outputs interfaces properties are only defined once connected : built again with the new counts
+	DigitalOutputsSP.clear();
+	INDI::OutputInterface::initProperties("Inputs&Outputs", relayCount, "Relay");
+	DigitalInputsSP.clear();
+	AnalogInputsNP.clear();
+	INDI::InputInterface::initProperties("Inputs&Outputs", digitalCount, ANALOG_INPUTS, "Digital");
+}
+
+//////////////////////////////////////
+/* relayForFunction */
+// relay in charge of the function, -1 if none
+int Ipx800::relayForFunction(int fonction)
+{
+	return functionChannel[RELAY_CHANNELS][fonction];
+}
+
+//////////////////////////////////////
+/* digitalForFunction */
+// digital input in charge of the function, -1 if none
+int Ipx800::digitalForFunction(int fonction)
+{
+	return functionChannel[DIGITAL_CHANNELS][fonction];
+}
 
 //////////////////////////////////////
 /* checkAnswer */
-bool Ipx800::checkAnswer()
+// one '0' / '1' per channel expected, validated and packed in answerBits at once
+bool Ipx800::checkAnswer(int channels)
 {
-    for (int i=0;i<8;i++)
+    if (answerLength < channels) {
+        LOGF_ERROR("Too short IPX answer : %s", rawAnswer);
+        return false;
+    }
+    if (!decodeStatus(rawAnswer, channels, answerBits))
     {
-        if ((tmpAnswer[i] == '0') || (tmpAnswer[i] == '1'))
-        {
-			return true;
-        }
-        else {
-            LOGF_ERROR("Wrong data in IPX answer : %s", tmpAnswer[i]);
-            return false;
-        }
+        LOGF_ERROR("Wrong data in IPX answer : %s", rawAnswer);
+        return false;
     }
 
     return true;
@@ -1091,22 +3420,57 @@ bool Ipx800::UpdateDigitalInputs()
 		return res;
 		}
 	else {
-		LOG_DEBUG("UpdateDigitalInputs - Send Command GetD successfull");
+		IPX_LOG_TRACE("UpdateDigitalInputs - Send Command GetD successfull");
 		
-		if (!checkAnswer())
+		if (!checkAnswer(digitalCount))
 		{
 			LOG_ERROR("UpdateDigitalInputs - Wrong Command GetD send");
 			res = false;
 		}
 		else {
 			recordData(GetD); 
+			updateMountStatus();
+			updateObsStatus();
+			updateInterlocks();
+			runPowerSequence();
 		}
 	}
 	return true; 
 }
 
+//////////////////////////////////////
+/* UpdateAnalogInputs */
+// All analog inputs read with a single request
 bool Ipx800::UpdateAnalogInputs()
 {
+	if (protocol->getAnalogs == nullptr)
+		return true;
+	bool res = readCommand(GetA);
+	readAnswer();
+	if (res==false) {
+		LOG_ERROR("UpdateAnalogInputs - Send Command GetA failed");
+		return res;
+	}
+	IPX_LOG_TRACE("UpdateAnalogInputs - Send Command GetA successfull");
+	recordData(GetA);
+	return true;
+}
+
+//////////////////////////////////////
+/* UpdateCounters */
+// All pulse counters read with a single request
+bool Ipx800::UpdateCounters()
+{
+	if (protocol->getCounters == nullptr)
+		return true;
+	bool res = readCommand(GetC);
+	readAnswer();
+	if (res==false) {
+		LOG_ERROR("UpdateCounters - Send Command GetC failed");
+		return res;
+	}
+	IPX_LOG_TRACE("UpdateCounters - Send Command GetC successfull");
+	recordData(GetC);
 	return true;
 }
 
@@ -1124,15 +3488,16 @@ bool Ipx800::UpdateDigitalOutputs()
 			return res;
 			}
 		else {
-			LOG_DEBUG("UpdateDigitalOutputs - Send Command GetR successfull");
+			IPX_LOG_TRACE("UpdateDigitalOutputs - Send Command GetR successfull");
 			
-			if (!checkAnswer())
+			if (!checkAnswer(relayCount))
 			{
 				LOG_ERROR("UpdateDigitalOutputs - Wrong Command GetR send");
 				res = false;
 			}
 			else {
 				recordData(GetR); 
+				updateInterlocks();
 			}
 		}
 		return true;
@@ -1140,14 +3505,32 @@ bool Ipx800::UpdateDigitalOutputs()
 
 //////////////////////////////////////
 /* CommandOutput */
-// 
+// Relay command from a client
 bool Ipx800::CommandOutput(uint32_t index, OutputState command) 
+{
+	return CommandOutput(index, command, EventLog::CAUSE_CLIENT);
+}
+
+//////////////////////////////////////
+/* CommandOutput */
+// Relay command, cause is kept in event log
+bool Ipx800::CommandOutput(uint32_t index, OutputState command, EventLog::Cause cause) 
 {
 	//check index is controling enginepower
 	int relayNumber = index+1;
 	bool rc = false;
+	int fonction = channelFunction[RELAY_CHANNELS][index];
+	
+	if (fonction > 0 && (interlockBlocked[command] & (1u << fonction))) {
+		eventLog.record(monotonicMs(), EventLog::EV_COMMAND, index, cause, command, EventLog::OUTCOME_INTERLOCK);
+		for (const auto &rule : interlockRules)
+			if (!rule.satisfied && rule.target == fonction && rule.command == command)
+				LOGF_WARN("Relay %d command refused by interlock \"%s\"", relayNumber, rule.text.c_str());
+		return false;
+	}
 	//modifier pour permettre l'emission de commande pour toutes les commandes....sans lien avec le moteur
-	if (roofPowerManagement && enginePowered==false && static_cast<uint32_t>(Relay_Fonction_Tab[ROOF_CONTROL_COMMAND])==static_cast<uint32_t>(index)) {
+	if (roofPowerManagement && enginePowered==false && relayForFunction(ROOF_CONTROL_COMMAND) == static_cast<int>(index)) {
+		eventLog.record(monotonicMs(), EventLog::EV_COMMAND, index, cause, command, EventLog::OUTCOME_ROOF_POWER);
 		LOG_WARN("Please switch on roof engine power");
 		return false; }
 	else {
@@ -1156,6 +3539,23 @@ bool Ipx800::CommandOutput(uint32_t index, OutputState command)
 		else
 			rc = writeCommand(ClearR, relayNumber);
 		readAnswer(); 
+		eventLog.record(monotonicMs(), EventLog::EV_COMMAND, index, cause, command,
+		                rc ? EventLog::OUTCOME_DONE : EventLog::OUTCOME_FAILED);
+		if (rc && command == INDI::OutputInterface::On && relayForFunction(ROOF_CONTROL_COMMAND) == static_cast<int>(index))
+			startRoofMotion();
+		
+		// auto-off : any On restarts the countdown, Off cancels it
+		if (rc && index < relayAutoOffID.size()) {
+			relayTimers.cancel(relayAutoOffID[index]);
+			relayAutoOffID[index] = -1;
+			if (command == INDI::OutputInterface::On && RelayAutoOffN[index].value > 0) {
+				relayAutoOffID[index] = relayTimers.schedule(RelayAutoOffN[index].value, [this, index]() {
+					relayAutoOffID[index] = -1;
+					LOGF_INFO("Relay %d switched off automatically", index+1);
+					CommandOutput(index, INDI::OutputInterface::Off, EventLog::CAUSE_AUTO_OFF);
+				});
+			}
+		}
 		return rc;
 	}
 		
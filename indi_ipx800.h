@@ -26,6 +26,20 @@ along with IPX800 INDI Driver.  If not, see
 #include <indiinputinterface.h>
 #include <indidevapi.h>
 #include <indiapi.h>
+
+#include "ipx800_timerwheel.h"
+#include "ipx800_window.h"
+#include "ipx800_eventlog.h"
+#include "ipx800_capture.h"
+#include "ipx800_snapshot.h"
+#include "ipx800_probe.h"
+#include "ipx800_usage.h"
+#include "ipx800_roofruns.h"
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
  
 class Ipx800 : public INDI::DefaultDevice, public INDI::InputInterface, public INDI::OutputInterface
  
@@ -47,6 +61,9 @@ class Ipx800 : public INDI::DefaultDevice, public INDI::InputInterface, public I
 	
     virtual bool ISSnoopDevice(XMLEle *root) override;
     virtual void ISGetProperties(const char *dev) ;
+    
+    // Timer callbacks
+    void expireRelayTimers();
  protected:
 	
 	bool Handshake();
@@ -58,8 +75,32 @@ class Ipx800 : public INDI::DefaultDevice, public INDI::InputInterface, public I
        GetR   = 1 << 0,
        GetD  = 1 << 1,
        SetR = 1 << 2,
-       ClearR = 1 << 3
+       ClearR = 1 << 3,
+       GetA = 1 << 4,
+       GetC = 1 << 5
    } ;
+
+	// Interlock rule : (interlockWord & mask) == value must hold to send command to target relay function
+	struct InterlockRule {
+		int target;
+		int command;
+		uint32_t mask;
+		uint32_t value;
+		bool satisfied;
+		std::string text;
+	};
+
+	// Power sequence step : relay function switched once dependencies (bitmask of
+	// previous steps) are done, then settleMs and optional confirmation input
+	struct PowerStep {
+		int fonction;
+		uint32_t settleMs;
+		uint32_t depends;
+		uint32_t dependents;
+		int confirm;
+		int state;
+		uint64_t startedAt;
+	};
        
 	///////////////////////////////////////////
 	// IPX800 Communication
@@ -68,16 +109,87 @@ class Ipx800 : public INDI::DefaultDevice, public INDI::InputInterface, public I
     void updateObsStatus();
     bool readCommand(IPX800_command);
     bool writeCommand(IPX800_command, int toSet);
-    bool checkAnswer();
+    bool checkAnswer(int channels);
     void readAnswer();
+    bool startProtocol(int version);
     void recordData(IPX800_command command);
     bool writeTCP(std::string toSend);
-	bool firstFonctionTabInit();
+	void buildFunctionIndex();
+	void assignFunction(int kind, int channel, int fonction);
+	void buildChannels(int relays, int digitals);
+	void setChannelCounts(int relays, int digitals);
+	void defineChannelProperties(bool config, bool states);
+	void deleteChannelProperties(bool config, bool states);
+	void syncChannelFunction(int kind, int i);
+	void defineTabs(int tabs);
+	void applySnapshot();
+	
+	// Incremental, debounced configuration saves
+	typedef std::function<void(FILE *)> ConfigSaver;
+	void forEachConfigItem(const std::function<void(const char *name, const ConfigSaver &save)> &visit);
+	void registerConfigItems();
+	void noteConfigChange(const char *dev, const char *name);
+	bool writeConfigFile();
+	void saveSnapshot();
+	void deleteTabs(int tabs);
+	int relayForFunction(int fonction);
+	int digitalForFunction(int fonction);
+	
+	// Roof motion supervision
+	void startRoofMotion(bool commanded = true);
+	void recordRoofRun(int direction, uint64_t endMs);
+	void publishRoofRuns(bool slow);
+	void cutRoofPower(const char *reason);
+	void publishRoofStatus();
+	
+	// Relays usage accounting
+	void updateRelayUsage();
+	
+	// Client updates rate limit
+	void publishLimited(int property, IPState state, TimerWheel::Action send);
+	
+	// Dome (roll-off) interface
+	bool moveRoof(int roofTarget);
+	bool abortRoof();
+	void updateDomeInterface();
+	
+	// Roof closing on weather alert
+	void prepareWeatherClose();
+	void weatherCloseRoof();
+	
+	// Dew heater
+	void updateDewPoint();
+	void runDewHeater();
+	void stopDewHeater();
+	
+	// Power sequencing
+	bool compilePowerSequence(const char *sequence);
+	bool startPowerSequence(int sequence);
+	void stopPowerSequence(IPState state, const char *message);
+	void runPowerSequence();
+	
+	// Pulsed, delayed and auto-off relay actions
+	bool pulseRelay(int relay, uint32_t durationMs);
+	bool delayRelay(int relay, uint32_t delayMs, OutputState command);
+	
+	// Digital inputs filtering
+	uint64_t filterDigitalInputs(uint64_t raw, uint64_t now);
+	
+	// Mount park detection
+	void updateMountStatus();
+	void publishMountStatus(IPState state);
+	
+	// Interlocks
+	bool compileInterlockRules(const char *rules);
+	void updateInterlocks(bool full = false);
+	void setInterlockRule(InterlockRule &rule, bool satisfied);
 	
     virtual bool UpdateDigitalInputs() override;
-    virtual bool UpdateAnalogInputs() override; // IPX800 Analog Inputs not managed
+    virtual bool UpdateAnalogInputs() override;
+    bool UpdateCounters();
     virtual bool UpdateDigitalOutputs() override;
     virtual bool CommandOutput(uint32_t index, OutputState command) override;
+    bool CommandOutput(uint32_t index, OutputState command, EventLog::Cause cause);
 	virtual bool saveConfigItems(FILE *fp) override;
 	
   private:
@@ -119,7 +231,28 @@ class Ipx800 : public INDI::DefaultDevice, public INDI::InputInterface, public I
         OTHER_DIGITAL_1,
         OTHER_DIGITAL_2 } IPXDigitalRead;
 	
-    char tmpAnswer[8]= {0};
+    // M2M dialect of an IPX800 generation, nullptr for a command it doesn't offer
+    struct Protocol {
+        int version;
+        ProbeRequest probe;
+        const char *getRelays;
+        const char *getDigitals;
+        const char *getAnalogs;
+        const char *getCounters;
+        const char *setRelay;          // printf format of the relay number
+        const char *clearRelay;
+        bool echoesCommand;            // answers are "<command>=<data>"
+    };
+    static const int PROTOCOLS = 3;
+    static const Protocol protocols[PROTOCOLS];
+    const Protocol *protocol = &protocols[1];
+    static const int PROBE_TIMEOUT = 1000;
+    std::string lastRequest;
+
+    // last answer, relays / digits states are one character per channel
+    char rawAnswer[72] = {0};
+    int answerLength = 0;
+    uint64_t answerBits = 0;    // relays / digits states of the last answer, set by checkAnswer()
     bool setupParams();
     float CalcTimeLeft(timeval);
 
@@ -127,19 +260,99 @@ class Ipx800 : public INDI::DefaultDevice, public INDI::InputInterface, public I
     ISState fullClosedLimitSwitch { ISS_OFF };
     double MotionRequest { 0 };
     struct timeval MotionStart { 0, 0 };
+    bool roofFault = false;
+    int PollTimerID = -1;
+
+    // Roof travel timeout (Options Tab) and supervision view (Roll Off Tab)
+    INumber RoofTimeoutN[1];
+    INumberVectorProperty RoofTimeoutNP;
+    INumber RoofTimeLeftN[1];
+    INumberVectorProperty RoofTimeLeftNP;
+    
+    // Roof runs : from the command to the limit switch edge, learned per direction.
+    // A run longer than the learned percentile raises an alert.
+    RoofRuns roofRuns;
+    uint64_t roofRunStart = 0;      // monotonic ms of the command, 0 when the run isn't timed
+    INumber RoofRunAlertN[2];
+    INumberVectorProperty RoofRunAlertNP;
+    INumber RoofRunsN[RoofRuns::DIRECTIONS * 3];
+    INumberVectorProperty RoofRunsNP;
+    ILight RoofStatusL[4];
+    ILightVectorProperty RoofStatusLP;
+
+    // Standard INDI Dome properties, published when Dome interface is enabled
+    bool domeInterface = false;
+    int roofPulseTimerID = -1;
+    int roofReverseTimerID = -1;       // second pulse, once a roof running the other way is stopped
+    int roofLastMotion = ROOF_STOPPED; // direction of the last run, reversed by the next pulse after a stop
+    ISwitch DomeInterfaceS[2];
+    ISwitchVectorProperty DomeInterfaceSP;
+    ISwitch DomeMotionS[2];
+    ISwitchVectorProperty DomeMotionSP;
+    ISwitch DomeParkS[2];
+    ISwitchVectorProperty DomeParkSP;
+    ISwitch DomeAbortS[1];
+    ISwitchVectorProperty DomeAbortSP;
+
+    // Channels : 8 relays and 8 digital inputs on a bare IPX800, more with X-8R / X-8D
+    // extensions. Counts are discovered at Handshake from the status replies length.
+    // Storage is reserved for MAX_CHANNELS so that properties never move.
+    static const int MAX_CHANNELS = 64;
+    static const int BASE_CHANNELS = 8;
+    enum { RELAY_CHANNELS, DIGITAL_CHANNELS, CHANNEL_KINDS };
 
-    ISwitch RelaisInfoS[11] {};
-    ISwitch Relais1InfoS[11], Relais2InfoS[11],Relais3InfoS[11],Relais4InfoS[11],Relais5InfoS[11],Relais6InfoS[11],Relais7InfoS[11],Relais8InfoS[11] {};
-    ISwitchVectorProperty RelaisInfoSP[8] {};
+    // One row per channel kind, every per channel property is generated from it
+    struct ChannelKind {
+        const char *configName;        // function selection, "%d" is the channel number
+        const char *legacyConfigName;  // name used by channels 4 to 8 in saved configurations, if different
+        const char *label;
+        const char *configTab;
+        const char * const *functionLabels;
+        int functions;
+        const char *stateName;         // state in Status Tab
+        const char * const *functionNames;
+        const char *groupConfigName;   // compact publication : all functions, and all states, in one vector
+        const char *groupStateName;
+        const char *groupLabel;
+    };
+    static const ChannelKind channelKinds[CHANNEL_KINDS];
 
-    ISwitch DigitalInputS[10] {};
-    ISwitch Digital1InputS[10], Digital2InputS[10], Digital3InputS[10], Digital4InputS[10], Digital5InputS[10], Digital6InputS[10], Digital7InputS[10], Digital8InputS[10];
-    ISwitchVectorProperty DigitalInputSP[8] {};
+    int channelCount[CHANNEL_KINDS] = {0, 0};
+    int &relayCount = channelCount[RELAY_CHANNELS];
+    int &digitalCount = channelCount[DIGITAL_CHANNELS];
+    std::vector<ISwitch> channelConfigS[CHANNEL_KINDS];
+    std::vector<ISwitchVectorProperty> channelConfigSP[CHANNEL_KINDS];
+    std::vector<ISwitch> channelStateS[CHANNEL_KINDS];
+    std::vector<ISwitchVectorProperty> channelStateSP[CHANNEL_KINDS];
+    std::vector<ISwitchVectorProperty> &RelaisInfoSP = channelConfigSP[RELAY_CHANNELS];
+    std::vector<ISwitchVectorProperty> &DigitalInputSP = channelConfigSP[DIGITAL_CHANNELS];
+    std::vector<ISwitchVectorProperty> &RelaysStatesSP = channelStateSP[RELAY_CHANNELS];
+    std::vector<ISwitchVectorProperty> &DigitsStatesSP = channelStateSP[DIGITAL_CHANNELS];
 
-    ISwitch Relay1StateS[2],Relay2StateS[2],Relay3StateS[2],Relay4StateS[2],Relay5StateS[2],Relay6StateS[2],Relay7StateS[2],Relay8StateS[2] ;
-    ISwitchVectorProperty RelaysStatesSP[8] ;
-    ISwitch Digit1StateS[2],Digit2StateS[2],Digit3StateS[2],Digit4StateS[2],Digit5StateS[2],Digit6StateS[2],Digit7StateS[2],Digit8StateS[2] ;
-    ISwitchVectorProperty DigitsStatesSP[8] ;
+    // Compact publication, Options Tab : one vector per channel group instead of one per channel,
+    // the Inputs&Outputs vectors being the per channel views
+    bool compactPublication = false;
+    ISwitch PublicationS[2];
+    ISwitchVectorProperty PublicationSP;
+    std::vector<IText> channelFunctionT[CHANNEL_KINDS];
+    ITextVectorProperty channelFunctionTP[CHANNEL_KINDS];
+    std::vector<ILight> channelStateL[CHANNEL_KINDS];
+    ILightVectorProperty channelStateLP[CHANNEL_KINDS];
+    // Rarely used tabs, only defined when shown (Options Tab)
+    enum { CONFIGURATION_TABS = 1 << 0, DIAGNOSTIC_TABS = 1 << 1 };
+    int shownTabs = CONFIGURATION_TABS;
+    ISwitch TabsS[2];
+    ISwitchVectorProperty TabsSP;
+    // connection request time, until the first valid relays / inputs state
+    uint64_t connectStartMs = 0;
+
+    // relay states last published : a poll only sends the relays that changed
+    uint64_t relayPublished = 0;
+    bool relayPublishedValid = false;
+
+    // Channels used at most (0 = all reported by the IPX800), Options Tab
+    INumber ChannelLimitN[2];
+    INumberVectorProperty ChannelLimitNP;
 
     //TO manage Password in a next release
     //IText LoginPwdT[2];
@@ -154,6 +367,15 @@ class Ipx800 : public INDI::DefaultDevice, public INDI::InputInterface, public I
     }
     Roof_Status;
 
+    // Roof motion deduced from commands and limit switches
+    enum {
+        ROOF_STOPPED ,
+        ROOF_OPENING ,
+        ROOF_CLOSING ,
+        ROOF_MOVING     // direction unknown
+    }
+    Roof_Motion;
+
     enum {
         RA_PARKED    ,
         DEC_PARKED   ,
@@ -162,20 +384,49 @@ class Ipx800 : public INDI::DefaultDevice, public INDI::InputInterface, public I
     }
     Mount_Status;
 
+    // Mount_Status is only accepted once stable during MountDebounceN
+    decltype(Mount_Status) mountCandidate = NONE_PARKED;
+    uint64_t mountCandidateSince = 0;   // 0 : no snapshot since connection
+    bool mountAccepted = false;         // Mount_Status observed since connection, Busy until then
+    INumber MountDebounceN[1];
+    INumberVectorProperty MountDebounceNP;
+    ISwitch MountParkS[4];
+    ISwitchVectorProperty MountParkSP;
+
+    // Interlocks : rules over relay / digital functions and roof / mount status
+    // interlockBlocked[command] has one bit per relay function refused for that command
+    std::vector<InterlockRule> interlockRules;
+    uint32_t interlockWord = 0;
+    uint32_t interlockBlocked[2] = {0, 0};
+    uint8_t interlockViolations[2][11] = {};
+    IText InterlockRulesT[1] {};
+    ITextVectorProperty InterlockRulesTP;
+
 	const char *ROLLOFF_TAB        = "Roll Off";
 	const char *RELAYS_CONFIGURATION_TAB        = "Relays Outputs";
 	const char *DIGITAL_INPUT_CONFIGURATION_TAB        = "Digital Inputs";
 	const char *RAW_DATA_TAB = "Status";
+	const char *RELAY_TIMERS_TAB = "Relay Timers";
+	const char *POWER_SEQUENCE_TAB = "Power Sequence";
+	const char *RELAY_USAGE_TAB = "Relay Usage";
+	const char *DEW_HEATER_TAB = "Dew Heater";
+	const char *ANALOG_INPUT_CONFIGURATION_TAB = "Analog Inputs";
 
-	const int DIGITAL_INTPUTS = 8;
-	const int RELAYS_OUTPUTS = 8;
+	static const int ANALOG_INPUTS = 4;
+	static const int ANALOG_WINDOW = 60;
+	static const int COUNTERS = 3;
 
 
-    // Relay_Fonction_Tab provide relay output in charge of the function
-    // fonctions are ordered arbitrarly as following. 
-    // Only 8 functions applicable - only 8 relays output on IPX800
-	// Others are spares
-	int Relay_Fonction_Tab [11] = {0};
+    // Function <-> channel index, kept in step with every function selection :
+    // functionChannel gives the channel in charge of a function (-1 if none),
+    // channelFunction the function of a channel (0 : UNUSED_RELAY / UNUSED_DIGIT)
+    static const int MAX_FUNCTIONS = 11;
+	int functionChannel[CHANNEL_KINDS][MAX_FUNCTIONS];
+	std::vector<int> channelFunction[CHANNEL_KINDS];
+	// digital inputs with reversed logic (ROOF_ENGINE_POWERED, RASPBERRY_SUPPLIED, MAIN_PC_SUPPLIED)
+	uint64_t reversedDigitals = 0;
+	
+    // relay fonctions are ordered arbitrarly as following. 
     /* 0: UNUSED_RELAY,
     ROOF_ENGINE_POWER_SUPPLY,
     TUBE_VENTILATION,
@@ -188,11 +439,7 @@ class Ipx800 : public INDI::DefaultDevice, public INDI::InputInterface, public I
     OTHER_POWER_SUPPLY_2,
     10 : OTHER_POWER_SUPPLY_3 */
 
-    // Digital_Fonction_Tab provide digital input in charge of the function
-    // fonctions are ordered arbitrarly as following. 
-	// Only 8 functions applicable - only 8 digital inputs on IPX800
-	// Others are spares
-	int Digital_Fonction_Tab [11] = {0};
+    // digital fonctions are ordered arbitrarly as following. 
     /*
        0:  UNUSED_DIGIT,
         DEC_AXIS_PARKED,
@@ -208,14 +455,161 @@ class Ipx800 : public INDI::DefaultDevice, public INDI::InputInterface, public I
 	
 	// status of each relay output and digital input
 	// ordered the same way in IPX800
-	bool relayState[8];
-    bool digitalState[8];
+	std::vector<bool> relayState;
+    std::vector<bool> digitalState;
+
+    // Digital inputs filter, on packed words (bit i = digital input i+1)
+    // a transition is accepted once stable for N samples and T ms
+    uint64_t digitalFiltered = 0;
+    uint64_t digitalPending = 0;
+    bool digitalFilterPrimed = false;
+    std::vector<uint8_t> digitalPendingCount;
+    std::vector<uint64_t> digitalPendingSince;
+    std::vector<uint64_t> digitalLastEdge;  // monotonic ms of last accepted edge, as first seen
+    std::vector<INumber> DigitalFilterSamplesN;
+    INumberVectorProperty DigitalFilterSamplesNP;
+    std::vector<INumber> DigitalFilterTimeN;
+    INumberVectorProperty DigitalFilterTimeNP;
 	
     int mount_Status = RA_PARKED | DEC_PARKED | BOTH_PARKED | NONE_PARKED;
     int roof_Status  = ROOF_IS_OPENED | ROOF_IS_CLOSED | UNKNOWN_STATUS;
 	bool enginePowered = false ; //  True = on / false = Off 
 	bool first_Start = false;
 	
+	// Relay timers : pulse, delay-then-set and auto-off, executed from the timing wheel
+	TimerWheel relayTimers;
+	int relayTimersCallbackID = -1;
+	
+	// Measured values sent to clients at most every UpdateIntervalN ms per property : intermediate
+	// values are coalesced, the latest is flushed from relayTimers. Alerts and state changes go at once.
+	enum {
+		LIMITED_ANALOG,                                  // one per analog input
+		LIMITED_ANALOG_STATS = LIMITED_ANALOG + ANALOG_INPUTS,
+		LIMITED_COUNTERS,
+		LIMITED_ROOF_MOTION,
+		LIMITED_PROPERTIES
+	};
+	struct RateLimit {
+		uint64_t lastSent = 0;
+		IPState lastState = IPS_IDLE;
+		int flushID = -1;
+	};
+	RateLimit rateLimits[LIMITED_PROPERTIES];
+	INumber UpdateIntervalN[4];
+	INumberVectorProperty UpdateIntervalNP;
+	std::vector<int> relayAutoOffID;
+	std::vector<int> relayPulseID;      // Off of a pulse in progress, per relay
+	INumber RelayPulseN[2];
+	INumberVectorProperty RelayPulseNP;
+	INumber RelayDelayN[3];
+	INumberVectorProperty RelayDelayNP;
+	std::vector<INumber> RelayAutoOffN;
+	INumberVectorProperty RelayAutoOffNP;
+	
+	// Relays usage : on time, cycles, energy from the configured power, duty over 24 h.
+	// Counters follow relay transitions, they are published and saved at a low rate.
+	static const uint32_t USAGE_PUBLISH_INTERVAL = 60000;
+	static const uint32_t USAGE_SAVE_INTERVAL = 600000;
+	RelayUsage relayUsage;
+	uint64_t usagePublishedAt = 0;
+	uint64_t usageSavedAt = 0;
+	std::vector<INumber> RelayWattsN;
+	INumberVectorProperty RelayWattsNP;
+	std::vector<INumber> RelayUsageN;
+	INumberVectorProperty RelayUsageNP;
+	
+	// Analog inputs : value = raw * gain + offset, published when moving more than deadband
+	SlidingWindow<ANALOG_WINDOW> analogWindow[ANALOG_INPUTS];
+	double analogPublished[ANALOG_INPUTS] = {0};
+	bool analogPrimed = false;
+	INumber AnalogScaleN[ANALOG_INPUTS * 2];
+	INumberVectorProperty AnalogScaleNP;
+	INumber AnalogDeadbandN[ANALOG_INPUTS];
+	INumberVectorProperty AnalogDeadbandNP;
+	INumber AnalogStatsN[ANALOG_INPUTS * 3];
+	INumberVectorProperty AnalogStatsNP;
+	
+	// M2M traffic capture, replayed offline by ipx800_replay
+	M2MCapture m2mCapture;
+	ISwitch M2MCaptureS[2];
+	ISwitchVectorProperty M2MCaptureSP;
+	
+	// Post-mortem recorder of relays / inputs transitions and relay commands
+	static const uint32_t EVENT_LOG_RECORDS = 16384;
+	EventLog eventLog;
+	
+	// Configuration : a saved property is only serialized again when it changed, and the config file is
+	// replaced at once (temporary file then rename), CONFIG_SAVE_DELAY ms after the last change
+	static const uint32_t CONFIG_SAVE_DELAY = 2000;
+	struct ConfigItem {
+		std::string xml;
+		bool dirty = true;
+	};
+	std::map<std::string, ConfigItem> configCache;
+	int configSaveID = -1;
+	std::string configWritten;      // config file content, as last read or written
+	
+	// Last verified state, shown as stale (IPS_BUSY) from startup until the first live read
+	StateSnapshot stateSnapshot;
+	bool snapshotPending = false;   // loaded, not yet defined to clients
+	bool staleState = false;        // status properties defined from the snapshot, not connected yet
+	
+	// Pulse counters : totals, rate per second over last poll, rate per minute smoothed over a minute
+	uint32_t counterLast[COUNTERS] = {0};
+	double counterRate[COUNTERS] = {0};   // smoothed rate per minute, updated at every poll
+	uint64_t counterLastAt = 0;
+	bool counterPrimed = false;
+	INumber CountersN[COUNTERS * 3];
+	INumberVectorProperty CountersNP;
+	
+	// Weather alert snoop, with prepared roof closing commands
+	bool weatherClose = false;
+	bool weatherAlert = false;
+	bool weatherCloseIssued = false;   // close pulse sent for this alert
+	int weatherCloseRelay = -1;
+	int weatherPowerRelay = -1;
+	char weatherCloseCommand[16] = "";
+	char weatherPowerCommand[16] = "";
+	IText WeatherSnoopT[2] {};
+	ITextVectorProperty WeatherSnoopTP;
+	ISwitch WeatherCloseS[2];
+	ISwitchVectorProperty WeatherCloseSP;
+	
+	// Dew heater : power from the margin between ambient and dew point temperatures,
+	// applied to HEATING_RESISTOR_1 / 2 as a slow PWM. Commands are sent after a poll
+	// only, when the relay state differs, within a budget of commands per minute.
+	enum { DEW_FULL_MARGIN, DEW_OFF_MARGIN, DEW_PERIOD, DEW_MIN_PULSE, DEW_MAX_COMMANDS };
+	enum { DEW_TEMPERATURE, DEW_HUMIDITY, DEW_POINT, DEW_MARGIN, DEW_POWER };
+	static const uint32_t DEW_DATA_TIMEOUT = 900000;
+	bool dewHeater = false;
+	double dewTemperature = NAN;
+	double dewHumidity = NAN;
+	double dewPower = 0;            // 0 to 1, from the last weather values
+	uint64_t dewDataAt = 0;
+	uint64_t dewPeriodStart = 0;
+	double dewTokens = 0;           // commands allowed now
+	uint64_t dewTokensAt = 0;
+	IText DewSnoopT[4] {};
+	ITextVectorProperty DewSnoopTP;
+	ISwitch DewHeaterS[2];
+	ISwitchVectorProperty DewHeaterSP;
+	INumber DewSettingsN[5];
+	INumberVectorProperty DewSettingsNP;
+	INumber DewStatusN[5];
+	INumberVectorProperty DewStatusNP;
+	
+	// Power sequencing
+	enum { POWER_IDLE, POWER_STARTUP, POWER_SHUTDOWN };
+	enum { STEP_WAITING, STEP_SETTLING, STEP_CONFIRMING, STEP_DONE };
+	std::vector<PowerStep> powerSteps;
+	int powerSequence = POWER_IDLE;
+	int powerSequenceRun = 0;
+	uint64_t powerSequenceStart = 0;
+	IText PowerSequenceT[1] {};
+	ITextVectorProperty PowerSequenceTP;
+	ISwitch PowerSequenceS[3];
+	ISwitchVectorProperty PowerSequenceSP;
+	
 	ISwitch IPXVersionS[5];
 	ISwitch roofEnginePowerS[2];
 	ISwitchVectorProperty IPXVersionSP, roofEnginePowerSP;
@@ -0,0 +1,92 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#include "ipx800_capture.h"
+
+#include <cstring>
+#include <ctime>
+
+const char M2MCapture::MAGIC[8] = { 'I', 'P', 'X', 'M', '2', 'M', '0', '1' };
+
+M2MCapture::~M2MCapture()
+{
+	close();
+}
+
+bool M2MCapture::open(const char *path)
+{
+	close();
+	file = fopen(path, "wbe");
+	if (file == nullptr)
+		return false;
+	if (fwrite(MAGIC, sizeof(MAGIC), 1, file) != 1) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void M2MCapture::close()
+{
+	if (file != nullptr)
+		fclose(file);
+	file = nullptr;
+}
+
+void M2MCapture::record(Direction direction, const char *data, uint32_t length)
+{
+	if (file == nullptr)
+		return;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	Record r {};
+	r.timeUs = static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+	r.direction = direction;
+	r.length = length;
+	fwrite(&r, sizeof(r), 1, file);
+	if (length > 0)
+		fwrite(data, 1, length, file);
+
+	// an exchange is complete once the answer is read : keep the file usable after a crash
+	if (direction != CAP_TX)
+		fflush(file);
+}
+
+bool M2MCapture::readHeader(FILE *f)
+{
+	char magic[sizeof(MAGIC)];
+	return fread(magic, sizeof(magic), 1, f) == 1 && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool M2MCapture::readRecord(FILE *f, Record &record, std::string &payload)
+{
+	if (fread(&record, sizeof(record), 1, f) != 1)
+		return false;
+	payload.resize(record.length);
+	return record.length == 0 || fread(&payload[0], 1, record.length, f) == record.length;
+}
+
+const char *M2MCapture::directionName(uint8_t direction)
+{
+	static const char *names[] = { "OPEN", "TX", "RX", "EOF", "ERROR", "CLOSE", "PROBE_TX", "PROBE_RX" };
+	return direction < sizeof(names) / sizeof(names[0]) ? names[direction] : "?";
+}
@@ -0,0 +1,71 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Capture of the M2M traffic, byte for byte, for offline replay with
+// ipx800_replay. A capture file is the MAGIC followed by records :
+// time (CLOCK_MONOTONIC, us), direction, payload length, payload.
+class M2MCapture
+{
+  public:
+	enum Direction : uint8_t {
+		CAP_OPEN = 0,  // connection established
+		CAP_TX,        // bytes written to IPX800
+		CAP_RX,        // one read() from IPX800, as it was split by the network
+		CAP_EOF,       // IPX800 closed the connection
+		CAP_ERROR,     // read error
+		CAP_CLOSE,     // driver disconnected
+		CAP_PROBE_TX,  // version probe request, sent on its own connection
+		CAP_PROBE_RX   // its accepted answer
+	};
+
+	struct Record {
+		uint64_t timeUs;
+		uint8_t direction;
+		uint8_t reserved[3];
+		uint32_t length;
+	};
+
+	static const char MAGIC[8];
+
+	M2MCapture() = default;
+	~M2MCapture();
+
+	bool open(const char *path);
+	void close();
+	bool isOpen() const { return file != nullptr; }
+
+	void record(Direction direction, const char *data = nullptr, uint32_t length = 0);
+
+	// replay side : checks MAGIC, then reads records one by one
+	static bool readHeader(FILE *f);
+	static bool readRecord(FILE *f, Record &record, std::string &payload);
+
+	static const char *directionName(uint8_t direction);
+
+  private:
+	FILE *file = nullptr;
+};
@@ -0,0 +1,97 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#include "ipx800_decode.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+bool decodeStatusScalar(const char *answer, int count, uint64_t &bits)
+{
+	uint64_t word = 0;
+	for (int i = 0; i < count; i++) {
+		if (answer[i] == '1')
+			word |= 1ull << i;
+		else if (answer[i] != '0')
+			return false;
+	}
+	bits = word;
+	return true;
+}
+
+bool decodeStatusSwar(const char *answer, int count, uint64_t &bits)
+{
+	uint64_t word = 0;
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		uint64_t chunk;
+		memcpy(&chunk, answer + i, sizeof(chunk));
+		// '0' / '1' become 0 / 1 in each byte, anything else leaves other bits set
+		chunk ^= 0x3030303030303030ull;
+		if (chunk & 0xFEFEFEFEFEFEFEFEull)
+			return false;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		chunk = __builtin_bswap64(chunk);
+#endif
+		// gathers bit 0 of byte k into bit 56 + k
+		word |= ((chunk * 0x0102040810204080ull) >> 56) << i;
+	}
+	uint64_t tail;
+	if (!decodeStatusScalar(answer + i, count - i, tail))
+		return false;
+	bits = word | (i < 64 ? tail << i : 0);
+	return true;
+}
+
+#if defined(__SSE2__)
+bool decodeStatusSse2(const char *answer, int count, uint64_t &bits)
+{
+	const __m128i zero = _mm_set1_epi8('0');
+	const __m128i one = _mm_set1_epi8('1');
+	uint64_t word = 0;
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(answer + i));
+		__m128i ones = _mm_cmpeq_epi8(chunk, one);
+		__m128i valid = _mm_or_si128(ones, _mm_cmpeq_epi8(chunk, zero));
+		if (_mm_movemask_epi8(valid) != 0xFFFF)
+			return false;
+		word |= static_cast<uint64_t>(_mm_movemask_epi8(ones)) << i;
+	}
+	uint64_t tail;
+	if (!decodeStatusSwar(answer + i, count - i, tail))
+		return false;
+	bits = word | (i < 64 ? tail << i : 0);
+	return true;
+}
+#endif
+
+bool decodeStatus(const char *answer, int count, uint64_t &bits)
+{
+#if defined(__SSE2__)
+	return decodeStatusSse2(answer, count, bits);
+#else
+	return decodeStatusSwar(answer, count, bits);
+#endif
+}
@@ -0,0 +1,42 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#pragma once
+
+#include <cstdint>
+
+// Decoding of M2M status replies (Get=R, Get=D) : one '0' / '1' character per
+// channel, packed into a word where bit i is channel i+1. All functions return
+// false if one of the first count characters (count <= 64) is not '0' or '1'.
+
+// Reference implementation, one character at a time
+bool decodeStatusScalar(const char *answer, int count, uint64_t &bits);
+
+// 8 characters at a time in a 64 bits register, portable
+bool decodeStatusSwar(const char *answer, int count, uint64_t &bits);
+
+#if defined(__SSE2__)
+// 16 characters at a time
+bool decodeStatusSse2(const char *answer, int count, uint64_t &bits);
+#endif
+
+// Fastest implementation available on this target
+bool decodeStatus(const char *answer, int count, uint64_t &bits);
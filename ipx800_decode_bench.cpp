@@ -0,0 +1,106 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+// Microbenchmark of the status reply decoders, checked against the scalar one.
+// Usage : ipx800_decode_bench [channels (56)] [iterations (10000000)]
+
+#include "ipx800_decode.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+typedef bool (*Decoder)(const char *, int, uint64_t &);
+
+static const int REPLIES = 1024;
+
+static double run(Decoder decode, const std::vector<std::vector<char>> &replies, int channels, long iterations,
+                  uint64_t &checksum)
+{
+	uint64_t sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (long n = 0; n < iterations; n++) {
+		uint64_t bits = 0;
+		if (decode(replies[n & (REPLIES - 1)].data(), channels, bits))
+			sum += bits;
+		else
+			sum ^= n;
+	}
+	double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	checksum = sum;
+	return elapsed / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	int channels = argc > 1 ? atoi(argv[1]) : 56;
+	long iterations = argc > 2 ? atol(argv[2]) : 10000000;
+	if (channels < 1 || channels > 64) {
+		fprintf(stderr, "channels : 1 to 64\n");
+		return 1;
+	}
+
+	// replies as read from the socket, a few of them corrupted
+	std::mt19937 random(800);
+	std::vector<std::vector<char>> replies(REPLIES, std::vector<char>(channels + 2));
+	for (int r = 0; r < REPLIES; r++) {
+		for (int i = 0; i < channels; i++)
+			replies[r][i] = (random() & 1) ? '1' : '0';
+		if (r % 64 == 0)
+			replies[r][random() % channels] = 'x';
+		replies[r][channels] = '\r';
+		replies[r][channels + 1] = '\n';
+	}
+
+	struct { const char *name; Decoder decode; } decoders[] = {
+		{ "scalar", decodeStatusScalar },
+		{ "swar", decodeStatusSwar },
+#if defined(__SSE2__)
+		{ "sse2", decodeStatusSse2 },
+#endif
+	};
+
+	// results must match the scalar reference, reply by reply
+	for (const auto &d : decoders)
+		for (int r = 0; r < REPLIES; r++) {
+			uint64_t expected = 0, bits = 0;
+			bool expectedOk = decodeStatusScalar(replies[r].data(), channels, expected);
+			bool ok = d.decode(replies[r].data(), channels, bits);
+			if (ok != expectedOk || (ok && bits != expected)) {
+				fprintf(stderr, "%s : wrong result for reply %d\n", d.name, r);
+				return 2;
+			}
+		}
+
+	printf("%d channels, %ld iterations\n", channels, iterations);
+	double reference = 0;
+	for (const auto &d : decoders) {
+		uint64_t checksum;
+		double ns = run(d.decode, replies, channels, iterations, checksum);
+		if (reference == 0)
+			reference = ns;
+		printf("%-8s %7.2f ns/reply  x%.1f  (checksum %016llx)\n", d.name, ns, reference / ns,
+		       static_cast<unsigned long long>(checksum));
+	}
+	return 0;
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+// Decoder for the event log written by indi_ipx800 : prints records from the
+// oldest to the newest one.
+// Usage : ipx800_eventdump [device | file]
+// A device name reads ~/.indi/<device>_events.bin, as written by the driver
+// (default device "Ipx800"). An argument with a '/' or ending in .bin is a file.
+
+#include "ipx800_eventlog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+	std::string path = argc > 1 ? argv[1] : "Ipx800";
+	bool isFile = path.find('/') != std::string::npos
+	              || (path.size() > 4 && path.compare(path.size() - 4, 4, ".bin") == 0);
+	if (!isFile) {
+		const char *home = getenv("HOME");
+		path = std::string(home ? home : ".") + "/.indi/" + path + "_events.bin";
+	}
+
+	FILE *f = fopen(path.c_str(), "rb");
+	if (f == nullptr) {
+		perror(path.c_str());
+		return 1;
+	}
+
+	EventLog::Header header;
+	if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, EventLog::MAGIC, sizeof(header.magic)) != 0
+	    || header.version != EventLog::VERSION || header.recordSize != sizeof(EventLog::Record)
+	    || header.capacity == 0) {
+		fprintf(stderr, "%s : not an IPX800 event log\n", path.c_str());
+		fclose(f);
+		return 1;
+	}
+
+	std::vector<EventLog::Record> records(header.capacity);
+	size_t count = fread(records.data(), sizeof(EventLog::Record), header.capacity, f);
+	fclose(f);
+	if (count != header.capacity) {
+		fprintf(stderr, "%s : truncated file\n", path.c_str());
+		return 1;
+	}
+
+	uint64_t first = header.head > header.capacity ? header.head - header.capacity : 0;
+	// monotonic to realtime offset, given by the last session record seen
+	int64_t offsetMs = 0;
+	bool dated = false;
+
+	for (uint64_t n = first; n < header.head; n++) {
+		const EventLog::Record &r = records[n % header.capacity];
+
+		if (r.kind == EventLog::EV_SESSION) {
+			uint32_t realSeconds = (static_cast<uint32_t>(r.oldValue) << 16) | r.newValue;
+			offsetMs = static_cast<int64_t>(realSeconds) * 1000 - static_cast<int64_t>(r.timeMs);
+			dated = true;
+		}
+
+		char when[32];
+		if (dated) {
+			int64_t realMs = static_cast<int64_t>(r.timeMs) + offsetMs;
+			time_t seconds = realMs / 1000;
+			struct tm tmWhen;
+			localtime_r(&seconds, &tmWhen);
+			size_t len = strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tmWhen);
+			snprintf(when + len, sizeof(when) - len, ".%03d", static_cast<int>(realMs % 1000));
+		}
+		else
+			snprintf(when, sizeof(when), "%llu ms", static_cast<unsigned long long>(r.timeMs));
+
+		switch (r.kind) {
+			case EventLog::EV_SESSION :
+				printf("%s  SESSION  driver started\n", when);
+				break;
+			case EventLog::EV_COMMAND :
+				printf("%s  COMMAND  relay %d %s (%s) : %s\n", when, r.channel + 1, r.oldValue ? "ON" : "OFF",
+				       EventLog::causeName(r.cause), EventLog::outcomeName(r.newValue));
+				break;
+			default :
+				printf("%s  %-7s  %d %s -> %s (%s)\n", when, EventLog::kindName(r.kind), r.channel + 1,
+				       r.oldValue ? "ON" : "OFF", r.newValue ? "ON" : "OFF", EventLog::causeName(r.cause));
+				break;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#include "ipx800_eventlog.h"
+
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char EventLog::MAGIC[8] = { 'I', 'P', 'X', 'E', 'V', 'L', 'O', 'G' };
+
+EventLog::~EventLog()
+{
+	close();
+}
+
+bool EventLog::open(const char *path, uint32_t capacity)
+{
+	close();
+	if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+		return false;
+
+	int fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return false;
+
+	size_t size = sizeof(Header) + static_cast<size_t>(capacity) * sizeof(Record);
+	struct stat st;
+	bool keep = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == size;
+	if (!keep && ftruncate(fd, size) != 0) {
+		::close(fd);
+		return false;
+	}
+
+	void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	header = static_cast<Header *>(map);
+	records = reinterpret_cast<Record *>(header + 1);
+	mappedSize = size;
+	mask = capacity - 1;
+
+	// an older or foreign file is restarted from scratch
+	keep = keep && memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == VERSION
+	       && header->capacity == capacity && header->recordSize == sizeof(Record);
+	if (!keep) {
+		memset(map, 0, size);
+		memcpy(header->magic, MAGIC, sizeof(MAGIC));
+		header->version = VERSION;
+		header->capacity = capacity;
+		header->recordSize = sizeof(Record);
+	}
+	head = header->head;
+
+	struct timespec mono, real;
+	clock_gettime(CLOCK_MONOTONIC, &mono);
+	clock_gettime(CLOCK_REALTIME, &real);
+	uint32_t realSeconds = static_cast<uint32_t>(real.tv_sec);
+	record(static_cast<uint64_t>(mono.tv_sec) * 1000 + mono.tv_nsec / 1000000, EV_SESSION, 0, CAUSE_POLL,
+	       realSeconds >> 16, realSeconds & 0xFFFF);
+	return true;
+}
+
+void EventLog::close()
+{
+	if (header != nullptr)
+		munmap(header, mappedSize);
+	header = nullptr;
+	records = nullptr;
+	mappedSize = 0;
+	head = 0;
+	mask = 0;
+}
+
+const char *EventLog::kindName(uint8_t kind)
+{
+	static const char *names[] = { "SESSION", "RELAY", "DIGITAL", "COMMAND" };
+	return kind < sizeof(names) / sizeof(names[0]) ? names[kind] : "?";
+}
+
+const char *EventLog::causeName(uint8_t cause)
+{
+	static const char *names[] = { "poll", "client", "timer", "auto-off", "sequence", "roof", "weather", "dew" };
+	return cause < sizeof(names) / sizeof(names[0]) ? names[cause] : "?";
+}
+
+const char *EventLog::outcomeName(uint16_t outcome)
+{
+	static const char *names[] = { "failed", "done", "interlock", "roof power" };
+	return outcome < sizeof(names) / sizeof(names[0]) ? names[outcome] : "?";
+}
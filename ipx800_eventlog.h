@@ -0,0 +1,107 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Always-on recorder of state transitions and commands, for post-mortem
+// analysis. Records go to a fixed-size ring in a memory-mapped file : writing
+// one is a single store into the mapping, no syscall and no formatting, and
+// what was written survives a driver crash. ipx800_eventdump decodes the file.
+class EventLog
+{
+  public:
+	enum Kind : uint8_t {
+		EV_SESSION = 0,  // log opened : old/new hold realtime seconds, to date the monotonic stamps
+		EV_RELAY,        // relay state read from IPX800
+		EV_DIGITAL,      // digital input accepted by the filter
+		EV_COMMAND       // relay command : old = command, new = outcome
+	};
+
+	enum Cause : uint8_t {
+		CAUSE_POLL = 0,
+		CAUSE_CLIENT,
+		CAUSE_TIMER,
+		CAUSE_AUTO_OFF,
+		CAUSE_SEQUENCE,
+		CAUSE_ROOF,
+		CAUSE_WEATHER,
+		CAUSE_DEW
+	};
+
+	enum Outcome : uint16_t {
+		OUTCOME_FAILED = 0,
+		OUTCOME_DONE,
+		OUTCOME_INTERLOCK,
+		OUTCOME_ROOF_POWER
+	};
+
+	struct Record {
+		uint64_t timeMs;     // CLOCK_MONOTONIC
+		uint8_t kind;
+		uint8_t channel;
+		uint8_t cause;
+		uint8_t reserved;
+		uint16_t oldValue;
+		uint16_t newValue;
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t capacity;   // records, power of two
+		uint32_t recordSize;
+		uint32_t reserved;
+		uint64_t head;       // records written since creation, next slot is head % capacity
+	};
+
+	static const char MAGIC[8];
+	static const uint32_t VERSION = 1;
+
+	EventLog() = default;
+	~EventLog();
+
+	// maps path, keeping its records when the layout matches
+	bool open(const char *path, uint32_t capacity);
+	void close();
+	bool isOpen() const { return records != nullptr; }
+
+	void record(uint64_t timeMs, Kind kind, uint8_t channel, Cause cause, uint16_t oldValue, uint16_t newValue)
+	{
+		if (records == nullptr)
+			return;
+		records[head & mask] = Record { timeMs, kind, channel, cause, 0, oldValue, newValue };
+		header->head = ++head;
+	}
+
+	static const char *kindName(uint8_t kind);
+	static const char *causeName(uint8_t cause);
+	static const char *outcomeName(uint16_t outcome);
+
+  private:
+	Header *header = nullptr;
+	Record *records = nullptr;
+	uint64_t head = 0;
+	uint64_t mask = 0;
+	size_t mappedSize = 0;
+};
@@ -0,0 +1,104 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+
+#include "config.h"
+#include "indiapi.h"
+#include "indilogger.h"
+
+// Hot path logging, to be used in Ipx800 methods.
+// - IPX_LOG(F)_DEBUG : the debug switch is tested before any argument is evaluated
+// - IPX_LOG(F)_TRACE : per channel / per byte details, compiled out unless
+//   IPX800_TRACE_LOG is set (cmake -DIPX800_TRACE_LOG=ON)
+// - IPX_LOG(F)_ERROR_LIMITED : one message per IPX_LOG_LIMIT_MS and call site,
+//   the number of identical messages dropped meanwhile is given with the next one
+
+#define IPX_LOG_LIMIT_MS 10000
+
+#define IPX_LOG_DEBUG(txt) \
+	do { if (isDebug()) LOG_DEBUG(txt); } while (0)
+#define IPX_LOGF_DEBUG(fmt, ...) \
+	do { if (isDebug()) LOGF_DEBUG(fmt, __VA_ARGS__); } while (0)
+
+#ifdef IPX800_TRACE_LOG
+#define IPX_LOG_TRACE(txt) IPX_LOG_DEBUG(txt)
+#define IPX_LOGF_TRACE(fmt, ...) IPX_LOGF_DEBUG(fmt, __VA_ARGS__)
+#else
+// still type checked, never evaluated
+#define IPX_LOG_TRACE(txt) \
+	do { if (false) LOG_DEBUG(txt); } while (0)
+#define IPX_LOGF_TRACE(fmt, ...) \
+	do { if (false) LOGF_DEBUG(fmt, __VA_ARGS__); } while (0)
+#endif
+
+struct LogRateLimit
+{
+	uint64_t lastMs = 0;
+	uint32_t suppressed = 0;
+	bool logged = false;
+
+	// true when the message may be logged, dropped gives how many were not since the last one
+	bool allow(uint32_t &dropped)
+	{
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		uint64_t nowMs = static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+		if (logged && nowMs - lastMs < IPX_LOG_LIMIT_MS) {
+			suppressed++;
+			return false;
+		}
+		dropped = suppressed;
+		suppressed = 0;
+		lastMs = nowMs;
+		logged = true;
+		return true;
+	}
+};
+
+#define IPX_LOG_ERROR_LIMITED(txt) \
+	do { \
+		static LogRateLimit ipxLogLimit; \
+		uint32_t ipxLogDropped = 0; \
+		if (ipxLogLimit.allow(ipxLogDropped)) { \
+			if (ipxLogDropped > 0) \
+				LOGF_ERROR("%s (%u identical messages dropped)", txt, ipxLogDropped); \
+			else \
+				LOG_ERROR(txt); \
+		} \
+	} while (0)
+#define IPX_LOGF_ERROR_LIMITED(fmt, ...) \
+	do { \
+		static LogRateLimit ipxLogLimit; \
+		uint32_t ipxLogDropped = 0; \
+		if (ipxLogLimit.allow(ipxLogDropped)) { \
+			char ipxLogText[MAXRBUF]; \
+			snprintf(ipxLogText, sizeof(ipxLogText), fmt, __VA_ARGS__); \
+			if (ipxLogDropped > 0) \
+				LOGF_ERROR("%s (%u identical messages dropped)", ipxLogText, ipxLogDropped); \
+			else \
+				LOG_ERROR(ipxLogText); \
+		} \
+	} while (0)
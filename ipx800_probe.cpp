@@ -0,0 +1,176 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#include "ipx800_probe.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <netdb.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static uint64_t probeClockMs()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+// non blocking connection started, -1 on failure
+static int startConnection(const char *host, uint16_t port)
+{
+	struct addrinfo hints = {}, *addresses = nullptr;
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &addresses) != 0)
+		return -1;
+
+	int fd = socket(addresses->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd >= 0 && connect(fd, addresses->ai_addr, addresses->ai_addrlen) != 0 && errno != EINPROGRESS) {
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(addresses);
+	return fd;
+}
+
+int probeFirst(const char *host, uint16_t defaultPort, const ProbeRequest *requests, int count, int timeoutMs,
+               std::string *answer)
+{
+	struct Attempt {
+		int fd;
+		bool sent;
+		std::string reply;
+	};
+	std::vector<Attempt> attempts(count);
+	for (int i = 0; i < count; i++)
+		attempts[i] = Attempt { startConnection(host, requests[i].port ? requests[i].port : defaultPort), false, "" };
+
+	uint64_t deadline = probeClockMs() + timeoutMs;
+	int found = -1, fallback = -1;
+	std::vector<struct pollfd> fds;
+	std::vector<int> polled;
+	while (found < 0) {
+		fds.clear();
+		polled.clear();
+		for (int i = 0; i < count; i++) {
+			if (attempts[i].fd < 0)
+				continue;
+			fds.push_back(pollfd { attempts[i].fd, static_cast<short>(attempts[i].sent ? POLLIN : POLLOUT), 0 });
+			polled.push_back(i);
+		}
+		uint64_t now = probeClockMs();
+		if (fds.empty() || now >= deadline)
+			break;
+		if (poll(fds.data(), fds.size(), static_cast<int>(deadline - now)) < 0 && errno != EINTR)
+			break;
+
+		for (size_t p = 0; p < fds.size() && found < 0; p++) {
+			Attempt &attempt = attempts[polled[p]];
+			if (fds[p].revents == 0)
+				continue;
+			bool failed = (fds[p].revents & (POLLERR | POLLNVAL)) != 0;
+			if (!failed && !attempt.sent) {
+				// connected : the request is small enough to go in one send
+				int error = 0;
+				socklen_t length = sizeof(error);
+				const char *request = requests[polled[p]].request;
+				failed = getsockopt(attempt.fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0
+				         || send(attempt.fd, request, strlen(request), MSG_NOSIGNAL) != static_cast<ssize_t>(strlen(request));
+				attempt.sent = true;
+			}
+			else if (!failed) {
+				char buffer[256];
+				ssize_t bytes = recv(attempt.fd, buffer, sizeof(buffer), 0);
+				failed = bytes <= 0;
+				if (!failed) {
+					attempt.reply.append(buffer, bytes);
+					if (requests[polled[p]].accept(attempt.reply.data(), attempt.reply.size())) {
+						if (!requests[polled[p]].fallback)
+							found = polled[p];
+						else {
+							// kept while other requests may still answer
+							if (fallback < 0)
+								fallback = polled[p];
+							failed = true;
+						}
+					}
+				}
+			}
+			if (failed) {
+				close(attempt.fd);
+				attempt.fd = -1;
+			}
+		}
+	}
+
+	for (Attempt &attempt : attempts)
+		if (attempt.fd >= 0)
+			close(attempt.fd);
+	if (found < 0)
+		found = fallback;
+	if (found >= 0 && answer != nullptr)
+		*answer = attempts[found].reply;
+	return found;
+}
+
+int cachedVersion(const char *path, const std::string &hostKey)
+{
+	std::ifstream cache(path);
+	std::string line;
+	while (std::getline(cache, line)) {
+		std::istringstream fields(line);
+		std::string key;
+		int version;
+		if (fields >> key >> version && key == hostKey)
+			return version;
+	}
+	return -1;
+}
+
+bool cacheVersion(const char *path, const std::string &hostKey, int version)
+{
+	std::ifstream cache(path);
+	std::ostringstream kept;
+	std::string line;
+	while (std::getline(cache, line)) {
+		std::istringstream fields(line);
+		std::string key;
+		if (fields >> key && key != hostKey)
+			kept << line << '\n';
+	}
+	if (version >= 0)
+		kept << hostKey << ' ' << version << '\n';
+	cache.close();
+
+	// replaced at once, a reader never sees a partial file
+	std::string temporary = std::string(path) + ".tmp";
+	std::ofstream updated(temporary, std::ios::trunc);
+	updated << kept.str();
+	updated.close();
+	return updated && rename(temporary.c_str(), path) == 0;
+}
@@ -0,0 +1,46 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Detection of the protocol spoken by a unit : every candidate request is
+// sent at once, each over its own TCP connection, and the first valid answer
+// wins. Detection costs one round trip, bounded by a single deadline.
+// A fallback request only wins once every other request failed or timed out.
+struct ProbeRequest {
+	uint16_t port;               // 0 : port given to probeFirst
+	const char *request;
+	bool (*accept)(const char *reply, size_t length);   // called on the answer received so far
+	bool fallback;               // weak answer, any other valid answer is preferred
+};
+
+// index of the first request accepted before timeoutMs, -1 if none. answer receives its reply.
+int probeFirst(const char *host, uint16_t defaultPort, const ProbeRequest *requests, int count, int timeoutMs,
+               std::string *answer = nullptr);
+
+// Per host cache of detection results, "host:port version" lines
+int cachedVersion(const char *path, const std::string &hostKey);
+// version < 0 removes the host
+bool cacheVersion(const char *path, const std::string &hostKey, int version);
@@ -0,0 +1,214 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+// Fake IPX800 replaying a M2M capture : connect the driver to this host and
+// port, and each request recorded in the capture gets its recorded answer,
+// split and delayed as it was (or faster, with speed > 1, or at once with 0).
+// A connection closed by the IPX800 in the capture is closed here too.
+// The version probe of the driver, made on a connection of its own, is answered too.
+// Usage : ipx800_replay capture_file [port (9870)] [speed (1.0)]
+
+#include "ipx800_capture.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct Step {
+	M2MCapture::Record record;
+	std::string payload;
+};
+
+static int acceptClient(int server)
+{
+	int client = accept(server, nullptr, nullptr);
+	if (client < 0)
+		perror("accept");
+	else
+		printf("driver connected\n");
+	return client;
+}
+
+// Version probes come on their own connections, beside the M2M one : they are accepted
+// until one sends the recorded request, the others are closed
+static int acceptProbe(int server, const std::string &request)
+{
+	struct pollfd waiting = { server, POLLIN, 0 };
+	while (poll(&waiting, 1, 2000) > 0) {
+		int probe = accept(server, nullptr, nullptr);
+		if (probe < 0)
+			break;
+		std::string received;
+		while (received.size() < request.size()) {
+			struct pollfd reading = { probe, POLLIN, 0 };
+			char buffer[256];
+			if (poll(&reading, 1, 300) <= 0)
+				break;
+			ssize_t bytes = read(probe, buffer, std::min(sizeof(buffer), request.size() - received.size()));
+			if (bytes <= 0)
+				break;
+			received.append(buffer, bytes);
+		}
+		if (received == request) {
+			printf("version probe connected\n");
+			return probe;
+		}
+		close(probe);
+	}
+	printf("version probe \"%s\" not received\n", request.c_str());
+	return -1;
+}
+
+static bool readExactly(int fd, std::string &data, size_t length)
+{
+	data.resize(length);
+	size_t received = 0;
+	while (received < length) {
+		ssize_t bytes = read(fd, &data[received], length - received);
+		if (bytes <= 0)
+			return false;
+		received += bytes;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		fprintf(stderr, "Usage : %s capture_file [port] [speed]\n", argv[0]);
+		return 1;
+	}
+	int port = argc > 2 ? atoi(argv[2]) : 9870;
+	double speed = argc > 3 ? atof(argv[3]) : 1.0;
+
+	FILE *f = fopen(argv[1], "rb");
+	if (f == nullptr || !M2MCapture::readHeader(f)) {
+		fprintf(stderr, "%s : not a M2M capture\n", argv[1]);
+		return 1;
+	}
+	std::vector<Step> steps;
+	Step step;
+	while (M2MCapture::readRecord(f, step.record, step.payload))
+		steps.push_back(step);
+	fclose(f);
+	if (steps.empty()) {
+		fprintf(stderr, "%s : empty capture\n", argv[1]);
+		return 1;
+	}
+
+	int server = socket(AF_INET, SOCK_STREAM, 0);
+	int yes = 1;
+	setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	struct sockaddr_in addr {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(server, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 || listen(server, 4) < 0) {
+		perror("bind");
+		return 1;
+	}
+	printf("replaying %zu records on port %d, speed %g\n", steps.size(), port, speed);
+
+	int client = -1, probe = -1;
+	unsigned requests = 0, mismatches = 0, sessions = 0;
+	uint64_t previousUs = steps.front().record.timeUs;
+	auto started = std::chrono::steady_clock::now();
+
+	for (const Step &s : steps) {
+		// answers keep their recorded delay from the previous record
+		if (s.record.direction != M2MCapture::CAP_TX && s.record.direction != M2MCapture::CAP_PROBE_TX && speed > 0 && s.record.timeUs > previousUs)
+			std::this_thread::sleep_for(std::chrono::microseconds(
+				static_cast<uint64_t>((s.record.timeUs - previousUs) / speed)));
+		previousUs = s.record.timeUs;
+
+		switch (s.record.direction) {
+			case M2MCapture::CAP_OPEN :
+				if (client >= 0)
+					close(client);
+				client = acceptClient(server);
+				if (sessions++ == 0)
+					started = std::chrono::steady_clock::now();
+				break;
+			case M2MCapture::CAP_TX :
+			{
+				if (client < 0 && (client = acceptClient(server)) < 0)
+					return 1;
+				std::string request;
+				if (!readExactly(client, request, s.payload.size())) {
+					printf("driver closed the connection\n");
+					close(client);
+					client = -1;
+					break;
+				}
+				requests++;
+				if (request != s.payload) {
+					mismatches++;
+					printf("request %u : expected \"%s\", got \"%s\"\n", requests, s.payload.c_str(), request.c_str());
+				}
+				previousUs = s.record.timeUs;
+				break;
+			}
+			case M2MCapture::CAP_PROBE_TX :
+				probe = acceptProbe(server, s.payload);
+				previousUs = s.record.timeUs;
+				break;
+			case M2MCapture::CAP_PROBE_RX :
+				if (probe >= 0) {
+					if (write(probe, s.payload.data(), s.payload.size()) < 0)
+						perror("write");
+					close(probe);
+				}
+				probe = -1;
+				break;
+			case M2MCapture::CAP_RX :
+				if (client >= 0 && write(client, s.payload.data(), s.payload.size()) < 0)
+					perror("write");
+				break;
+			case M2MCapture::CAP_EOF :
+			case M2MCapture::CAP_CLOSE :
+				if (client >= 0)
+					close(client);
+				client = -1;
+				break;
+			default :
+				break;
+		}
+	}
+	if (client >= 0)
+		close(client);
+	close(server);
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	double recorded = (steps.back().record.timeUs - steps.front().record.timeUs) / 1e6;
+	printf("%u sessions, %u requests, %u mismatches, %.3f s replayed (%.3f s recorded)\n",
+	       sessions, requests, mismatches, elapsed, recorded);
+	return mismatches ? 2 : 0;
+}
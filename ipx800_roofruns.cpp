@@ -0,0 +1,132 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#include "ipx800_roofruns.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+const char RoofRuns::MAGIC[8] = { 'I', 'P', 'X', 'R', 'U', 'N', 'S', '\0' };
+
+RoofRuns::~RoofRuns()
+{
+	close();
+}
+
+bool RoofRuns::open(const char *path)
+{
+	close();
+	fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return false;
+
+	// an older, foreign or truncated file holds no run
+	File file;
+	if (pread(fd, &file, sizeof(file), 0) != static_cast<ssize_t>(sizeof(file))
+	    || memcmp(file.magic, MAGIC, sizeof(MAGIC)) != 0 || file.version != VERSION
+	    || file.runs != RUNS)
+		return true;
+
+	memcpy(history, file.history, sizeof(history));
+	memset(bins, 0, sizeof(bins));
+	for (int direction=0; direction<DIRECTIONS; direction++)
+		for (int i=0; i<size(direction); i++)
+			bins[direction][bin(history[direction].runs[i])]++;
+	return true;
+}
+
+void RoofRuns::close()
+{
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+}
+
+int RoofRuns::bin(uint32_t ms)
+{
+	return std::min<uint32_t>(ms / BIN_MS, BINS - 1);
+}
+
+int RoofRuns::size(int direction) const
+{
+	return static_cast<int>(std::min<uint64_t>(history[direction].count, RUNS));
+}
+
+uint32_t RoofRuns::last(int direction) const
+{
+	const History &h = history[direction];
+	return h.count ? h.runs[(h.count - 1) % RUNS] : 0;
+}
+
+uint32_t RoofRuns::percentile(int direction, double p) const
+{
+	int runs = size(direction);
+	if (runs == 0)
+		return 0;
+	int needed = std::max(1, static_cast<int>(runs * p / 100.0 + 0.999));
+	int seen = 0;
+	for (int i=0; i<BINS; i++) {
+		seen += bins[direction][i];
+		if (seen >= needed)
+			return (i + 1) * BIN_MS;
+	}
+	return BINS * BIN_MS;
+}
+
+double RoofRuns::trend(int direction) const
+{
+	const History &h = history[direction];
+	int runs = size(direction);
+	if (runs < 2)
+		return 0;
+	// x : run order, oldest first
+	double sx = 0, sy = 0, sxx = 0, sxy = 0;
+	for (int x=0; x<runs; x++) {
+		double y = h.runs[(h.count - runs + x) % RUNS];
+		sx += x;
+		sy += y;
+		sxx += static_cast<double>(x) * x;
+		sxy += x * y;
+	}
+	return (runs * sxy - sx * sy) / (runs * sxx - sx * sx);
+}
+
+bool RoofRuns::record(int direction, uint32_t ms)
+{
+	History &h = history[direction];
+	uint32_t &slot = h.runs[h.count % RUNS];
+	if (h.count >= RUNS)
+		bins[direction][bin(slot)]--;
+	slot = ms;
+	bins[direction][bin(ms)]++;
+	h.count++;
+
+	if (fd < 0)
+		return false;
+	File file = {};
+	memcpy(file.magic, MAGIC, sizeof(MAGIC));
+	file.version = VERSION;
+	file.runs = RUNS;
+	memcpy(file.history, history, sizeof(history));
+	return pwrite(fd, &file, sizeof(file), 0) == static_cast<ssize_t>(sizeof(file));
+}
@@ -0,0 +1,75 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#pragma once
+
+#include <cstdint>
+
+// Durations of the last roof runs, per direction, with a histogram of fixed width
+// bins kept in step : a percentile is a scan of the bins. Kept in a small file,
+// written after each run, so that what is learned survives restarts.
+class RoofRuns
+{
+  public:
+	enum { OPEN, CLOSE, DIRECTIONS };
+	static const int RUNS = 64;
+	static const uint32_t BIN_MS = 250;
+	static const int BINS = 2400;       // 10 min, longer runs fall in the last bin
+
+	static const char MAGIC[8];
+	static const uint32_t VERSION = 1;
+
+	RoofRuns() = default;
+	~RoofRuns();
+
+	// opens path, loading the runs it holds if valid
+	bool open(const char *path);
+	void close();
+	bool isOpen() const { return fd >= 0; }
+
+	int size(int direction) const;
+	uint32_t last(int direction) const;
+	// upper edge of the bin reaching p % of the runs kept, 0 without runs
+	uint32_t percentile(int direction, double p) const;
+	// least squares slope over the runs kept, ms per run
+	double trend(int direction) const;
+
+	// run added, file written
+	bool record(int direction, uint32_t ms);
+
+  private:
+	struct History {
+		uint64_t count;
+		uint32_t runs[RUNS];
+	};
+	struct File {
+		char magic[8];
+		uint32_t version;
+		uint32_t runs;
+		History history[DIRECTIONS];
+	};
+
+	static int bin(uint32_t ms);
+
+	int fd = -1;
+	History history[DIRECTIONS] = {};
+	uint16_t bins[DIRECTIONS][BINS] = {};
+};
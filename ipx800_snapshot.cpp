@@ -0,0 +1,80 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#include "ipx800_snapshot.h"
+
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+const char StateSnapshot::MAGIC[8] = { 'I', 'P', 'X', 'S', 'T', 'A', 'T', 'E' };
+
+StateSnapshot::~StateSnapshot()
+{
+	close();
+}
+
+bool StateSnapshot::open(const char *path)
+{
+	close();
+	fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return false;
+
+	// an older, foreign or truncated file holds no state
+	File file;
+	loaded = pread(fd, &file, sizeof(file), 0) == static_cast<ssize_t>(sizeof(file))
+	         && memcmp(file.magic, MAGIC, sizeof(MAGIC)) == 0 && file.version == VERSION
+	         && file.stateSize == sizeof(State);
+	current = loaded ? file.state : State {};
+	return true;
+}
+
+void StateSnapshot::close()
+{
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+	loaded = false;
+}
+
+bool StateSnapshot::save(const State &state)
+{
+	if (fd < 0)
+		return false;
+	if (loaded && state.relayBits == current.relayBits && state.digitalBits == current.digitalBits
+	    && state.relays == current.relays && state.digitals == current.digitals
+	    && state.mountStatus == current.mountStatus && state.roofStatus == current.roofStatus)
+		return true;
+
+	File file = {};
+	memcpy(file.magic, MAGIC, sizeof(MAGIC));
+	file.version = VERSION;
+	file.stateSize = sizeof(State);
+	file.state = state;
+	file.state.savedAt = static_cast<uint64_t>(time(nullptr));
+	if (pwrite(fd, &file, sizeof(file), 0) != static_cast<ssize_t>(sizeof(file)))
+		return false;
+	current = file.state;
+	loaded = true;
+	return true;
+}
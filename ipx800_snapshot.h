@@ -0,0 +1,70 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#pragma once
+
+#include <cstdint>
+
+// Last verified relays / digital inputs / mount / roof state, kept in a small
+// file so that a restarted driver has usable state before the IPX800 answers.
+// The file is only written when the state changes, with a single pwrite().
+class StateSnapshot
+{
+  public:
+	struct State {
+		uint64_t relayBits;
+		uint64_t digitalBits;
+		uint64_t savedAt;      // realtime seconds of the live read
+		uint8_t relays;
+		uint8_t digitals;
+		uint8_t mountStatus;
+		uint8_t roofStatus;
+		uint32_t reserved;
+	};
+
+	static const char MAGIC[8];
+	static const uint32_t VERSION = 1;
+
+	StateSnapshot() = default;
+	~StateSnapshot();
+
+	// opens path, loading the state it holds if valid
+	bool open(const char *path);
+	void close();
+	bool isOpen() const { return fd >= 0; }
+	bool hasState() const { return loaded; }
+	const State &state() const { return current; }
+
+	// written when it differs from the last saved state, savedAt aside
+	bool save(const State &state);
+
+  private:
+	struct File {
+		char magic[8];
+		uint32_t version;
+		uint32_t stateSize;
+		State state;
+	};
+
+	int fd = -1;
+	bool loaded = false;
+	State current = {};
+};
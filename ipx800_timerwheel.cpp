@@ -0,0 +1,167 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the Lesser GNU General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+Timing wheel used for pulsed, delayed and auto-off relay actions.
+*******************************************************************************/
+
+#include "ipx800_timerwheel.h"
+
+#include <ctime>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+TimerWheel::~TimerWheel()
+{
+	close();
+}
+
+uint64_t TimerWheel::nowMs()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+bool TimerWheel::open()
+{
+	if (timerFD >= 0)
+		return true;
+	timerFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	currentTick = nowMs();
+	return timerFD >= 0;
+}
+
+void TimerWheel::close()
+{
+	if (timerFD >= 0)
+		::close(timerFD);
+	timerFD = -1;
+	for (auto &slot : slots)
+		slot.clear();
+	entries.clear();
+	deadlines = decltype(deadlines)();
+	armedDeadline = 0;
+}
+
+//////////////////////////////////////
+/* schedule */
+int TimerWheel::schedule(uint32_t delayMs, Action action)
+{
+	if (timerFD < 0)
+		return -1;
+
+	// a deadline already elapsed is run on the next tick
+	uint64_t deadline = nowMs() + (delayMs ? delayMs : 1);
+	if (deadline <= currentTick)
+		deadline = currentTick + 1;
+
+	if (++lastID < 0)
+		lastID = 1;
+	Slot &slot = slots[deadline % SLOTS];
+	entries[lastID] = slot.insert(slot.end(), { lastID, deadline, std::move(action) });
+	deadlines.push({ deadline, lastID });
+
+	if (armedDeadline == 0 || deadline < armedDeadline)
+		arm();
+	return lastID;
+}
+
+//////////////////////////////////////
+/* cancel */
+bool TimerWheel::cancel(int id)
+{
+	auto entry = entries.find(id);
+	if (entry == entries.end())
+		return false;
+	slots[entry->second->deadline % SLOTS].erase(entry->second);
+	entries.erase(entry);
+	return true;
+}
+
+//////////////////////////////////////
+/* clear */
+// drop every pending action
+void TimerWheel::clear()
+{
+	for (auto &slot : slots)
+		slot.clear();
+	entries.clear();
+	deadlines = decltype(deadlines)();
+	if (timerFD >= 0)
+		arm();
+}
+
+//////////////////////////////////////
+/* expire */
+// Walk the slots elapsed since last call (at most one turn) and run due actions.
+// Actions are collected first, they may schedule new timers.
+void TimerWheel::expire()
+{
+	uint64_t expirations;
+	if (read(timerFD, &expirations, sizeof(expirations)) < 0) {
+		// spurious wake-up, nothing to drain
+	}
+
+	uint64_t now = nowMs();
+	uint64_t steps = now - currentTick;
+	if (steps > SLOTS)
+		steps = SLOTS;
+
+	std::vector<Action> due;
+	for (uint64_t tick = now - steps + 1; tick <= now; tick++) {
+		auto &slot = slots[tick % SLOTS];
+		for (auto it = slot.begin(); it != slot.end();) {
+			if (it->deadline <= now) {
+				due.push_back(std::move(it->action));
+				entries.erase(it->id);
+				it = slot.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+	currentTick = now;
+	armedDeadline = 0;
+
+	for (auto &action : due)
+		action();
+
+	if (armedDeadline == 0)
+		arm();
+}
+
+//////////////////////////////////////
+/* arm */
+// One-shot timerfd on the nearest deadline, disarmed when nothing is pending.
+// Heap tops already run or cancelled are dropped here.
+void TimerWheel::arm()
+{
+	while (!deadlines.empty() && entries.count(deadlines.top().second) == 0)
+		deadlines.pop();
+	uint64_t next = deadlines.empty() ? 0 : deadlines.top().first;
+
+	struct itimerspec spec {};
+	if (next != 0) {
+		spec.it_value.tv_sec = next / 1000;
+		spec.it_value.tv_nsec = (next % 1000) * 1000000;
+	}
+	timerfd_settime(timerFD, TFD_TIMER_ABSTIME, &spec, nullptr);
+	armedDeadline = next;
+}
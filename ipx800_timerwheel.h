@@ -0,0 +1,76 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Hashed timing wheel with 1 ms ticks, driven by a one-shot timerfd armed on
+// the nearest deadline. fd() is registered in the INDI event loop, expire()
+// runs the actions due when it becomes readable.
+// cancel() is O(1) through an id index, the nearest deadline comes from a heap
+// whose cancelled entries are dropped lazily.
+class TimerWheel
+{
+  public:
+	typedef std::function<void()> Action;
+
+	TimerWheel() = default;
+	~TimerWheel();
+
+	bool open();
+	void close();
+	int fd() const { return timerFD; }
+
+	// returns an id for cancel(), -1 on failure
+	int schedule(uint32_t delayMs, Action action);
+	bool cancel(int id);
+	void clear();
+	void expire();
+
+	static uint64_t nowMs();
+
+  private:
+	static const uint32_t SLOTS = 256;
+
+	struct Entry {
+		int id;
+		uint64_t deadline;
+		Action action;
+	};
+	typedef std::list<Entry> Slot;
+	typedef std::pair<uint64_t, int> Deadline;    // deadline, id
+
+	void arm();
+
+	int timerFD = -1;
+	int lastID = 0;
+	uint64_t currentTick = 0;
+	uint64_t armedDeadline = 0;
+	Slot slots[SLOTS];
+	std::unordered_map<int, Slot::iterator> entries;
+	std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines;
+};
@@ -0,0 +1,204 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#include "ipx800_usage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+const char RelayUsage::MAGIC[8] = { 'I', 'P', 'X', 'U', 'S', 'A', 'G', 'E' };
+
+RelayUsage::~RelayUsage()
+{
+	close();
+}
+
+bool RelayUsage::open(const char *path)
+{
+	close();
+	fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return false;
+
+	// an older, foreign or truncated file starts counting from zero
+	File file;
+	if (pread(fd, &file, sizeof(file), 0) != static_cast<ssize_t>(sizeof(file))
+	    || memcmp(file.magic, MAGIC, sizeof(MAGIC)) != 0 || file.version != VERSION
+	    || file.counterSize != sizeof(Counter))
+		return true;
+
+	memcpy(counters, file.counters, sizeof(counters));
+	onBits = file.onBits;
+	resumeBits = file.resumeBits;
+	currentHour = file.currentHour;
+	firstMs = file.firstMs;
+	// what happened while the driver was stopped is unknown : spans end at last save
+	closeSpans(file.savedAt);
+	return true;
+}
+
+void RelayUsage::close()
+{
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+}
+
+//////////////////////////////////////
+/* addSpan */
+// Closed on time, spread over the hour buckets still in the window
+void RelayUsage::addSpan(Counter &counter, uint64_t from, uint64_t to)
+{
+	if (to <= from)
+		return;
+	counter.onMs += to - from;
+	from = std::max(from, (currentHour + 1 - HOURS) * HOUR_MS);
+	while (from < to) {
+		uint64_t hour = from / HOUR_MS;
+		uint64_t end = std::min(to, (hour + 1) * HOUR_MS);
+		counter.hourMs[hour % HOURS] += static_cast<uint32_t>(end - from);
+		from = end;
+	}
+}
+
+//////////////////////////////////////
+/* advance */
+// New hours : their buckets are emptied, and open spans are folded in up to the hour
+void RelayUsage::advance(uint64_t nowMs)
+{
+	uint64_t hour = nowMs / HOUR_MS;
+	if (hour <= currentHour)
+		return;
+	for (uint64_t h = std::max(currentHour + 1, hour + 1 - HOURS); h <= hour; h++)
+		for (Counter &counter : counters)
+			counter.hourMs[h % HOURS] = 0;
+	currentHour = hour;
+	
+	uint64_t boundary = hour * HOUR_MS;
+	for (uint64_t open = onBits & ~resumeBits; open; open &= open - 1) {
+		Counter &counter = counters[__builtin_ctzll(open)];
+		addSpan(counter, counter.onSince, boundary);
+		counter.onSince = boundary;
+	}
+	dirty = true;
+}
+
+//////////////////////////////////////
+/* closeSpans */
+void RelayUsage::closeSpans(uint64_t nowMs)
+{
+	advance(nowMs);
+	for (uint64_t open = onBits & ~resumeBits; open; open &= open - 1) {
+		Counter &counter = counters[__builtin_ctzll(open)];
+		addSpan(counter, counter.onSince, nowMs);
+		counter.onSince = 0;
+	}
+	resumeBits = onBits;
+	dirty = true;
+}
+
+void RelayUsage::update(uint64_t relayBits, uint64_t mask, uint64_t nowMs)
+{
+	if (firstMs == 0) {
+		firstMs = nowMs;
+		currentHour = nowMs / HOUR_MS;
+	}
+	advance(nowMs);
+	relayBits &= mask;
+
+	// relays on before a restart or a disconnection : still on, their span restarts without
+	// a new cycle, off meanwhile, there is nothing to close
+	for (uint64_t resumed = resumeBits & relayBits; resumed; resumed &= resumed - 1)
+		counters[__builtin_ctzll(resumed)].onSince = nowMs;
+	onBits &= ~(resumeBits & ~relayBits);
+	resumeBits = 0;
+	
+	uint64_t changed = relayBits ^ onBits;
+
+	for (; changed; changed &= changed - 1) {
+		int relay = __builtin_ctzll(changed);
+		Counter &counter = counters[relay];
+		if ((relayBits >> relay) & 1u) {
+			counter.cycles++;
+			counter.onSince = nowMs;
+		}
+		else {
+			addSpan(counter, counter.onSince, nowMs);
+			counter.onSince = 0;
+		}
+		dirty = true;
+	}
+	onBits = relayBits;
+}
+
+void RelayUsage::suspend(uint64_t nowMs)
+{
+	if (firstMs != 0)
+		closeSpans(nowMs);
+}
+
+uint64_t RelayUsage::onMs(int relay, uint64_t nowMs) const
+{
+	const Counter &counter = counters[relay];
+	bool open = ((onBits & ~resumeBits) >> relay) & 1u;
+	return counter.onMs + (open && nowMs > counter.onSince ? nowMs - counter.onSince : 0);
+}
+
+double RelayUsage::duty(int relay, uint64_t nowMs) const
+{
+	if (firstMs == 0 || nowMs <= firstMs)
+		return 0;
+	const Counter &counter = counters[relay];
+	uint64_t on = 0;
+	for (uint32_t ms : counter.hourMs)
+		on += ms;
+	bool open = ((onBits & ~resumeBits) >> relay) & 1u;
+	if (open && nowMs > counter.onSince)
+		on += nowMs - counter.onSince;
+	uint64_t windowStart = std::max(firstMs, (currentHour + 1 - HOURS) * HOUR_MS);
+	return nowMs > windowStart ? std::min(1.0, static_cast<double>(on) / (nowMs - windowStart)) : 0;
+}
+
+bool RelayUsage::save(uint64_t nowMs)
+{
+	if (fd < 0)
+		return false;
+	advance(nowMs);
+	if (!dirty)
+		return true;
+
+	File file = {};
+	memcpy(file.magic, MAGIC, sizeof(MAGIC));
+	file.version = VERSION;
+	file.counterSize = sizeof(Counter);
+	file.onBits = onBits;
+	file.resumeBits = resumeBits;
+	file.currentHour = currentHour;
+	file.firstMs = firstMs;
+	file.savedAt = nowMs;
+	memcpy(file.counters, counters, sizeof(counters));
+	if (pwrite(fd, &file, sizeof(file), 0) != static_cast<ssize_t>(sizeof(file)))
+		return false;
+	dirty = false;
+	return true;
+}
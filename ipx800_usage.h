@@ -0,0 +1,92 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#pragma once
+
+#include <cstdint>
+
+// Cumulated usage of each relay : on time, switching cycles, and on time over the
+// last 24 hours in hourly buckets. Only relays that changed are touched at each
+// update, open spans are folded in once per hour. Kept in a small file, so that
+// counting goes on across runs.
+class RelayUsage
+{
+  public:
+	static const int MAX_RELAYS = 64;
+	static const int HOURS = 24;
+	static const uint64_t HOUR_MS = 3600000;
+
+	static const char MAGIC[8];
+	static const uint32_t VERSION = 1;
+
+	RelayUsage() = default;
+	~RelayUsage();
+
+	// opens path, loading the counters it holds if valid. Relays on at last save
+	// count again from the next update, without a new cycle if still on.
+	bool open(const char *path);
+	void close();
+	bool isOpen() const { return fd >= 0; }
+
+	// relays state read at nowMs (realtime ms), mask gives the relays in use
+	void update(uint64_t relayBits, uint64_t mask, uint64_t nowMs);
+	// state no longer known (disconnection) : open spans are closed at nowMs
+	void suspend(uint64_t nowMs);
+
+	uint64_t onMs(int relay, uint64_t nowMs) const;
+	uint64_t cycles(int relay) const { return counters[relay].cycles; }
+	// on time fraction over the last 24 hours (since the first update if shorter)
+	double duty(int relay, uint64_t nowMs) const;
+
+	// written when counters changed since last save
+	bool save(uint64_t nowMs);
+
+  private:
+	struct Counter {
+		uint64_t onMs;                 // closed spans only
+		uint64_t cycles;               // off to on transitions
+		uint64_t onSince;              // start of the open span, 0 if none
+		uint32_t hourMs[HOURS];        // on time in each of the last hours, by epoch hour % HOURS
+	};
+	struct File {
+		char magic[8];
+		uint32_t version;
+		uint32_t counterSize;
+		uint64_t onBits;
+		uint64_t resumeBits;
+		uint64_t currentHour;
+		uint64_t firstMs;
+		uint64_t savedAt;
+		Counter counters[MAX_RELAYS];
+	};
+
+	void advance(uint64_t nowMs);
+	void addSpan(Counter &counter, uint64_t from, uint64_t to);
+	void closeSpans(uint64_t nowMs);
+
+	int fd = -1;
+	bool dirty = false;
+	uint64_t onBits = 0;          // relays on at last update
+	uint64_t resumeBits = 0;      // relays on whose span restarts at next update
+	uint64_t currentHour = 0;     // epoch hour of the newest bucket
+	uint64_t firstMs = 0;         // first update ever, for duty over less than a day
+	Counter counters[MAX_RELAYS] = {};
+};
@@ -0,0 +1,75 @@
+/*******************************************************************************
+This file is part of the IPX800 INDI Driver.
+A driver for the IPX800 (GCE Electronics - https://www.gce-electronics.com)
+
+Copyright (C) 2024 Arnaud Dupont (aknotwot@protonmail.com)
+
+IPX800 INDI Driver is free software : you can redistribute it
+and / or modify it under the terms of the GNU Lesser General Public License as
+published by the Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+
+IPX800 INDI Driver is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with IPX800 INDI Driver.  If not, see
+< http : //www.gnu.org/licenses/>.
+
+*******************************************************************************/
+#pragma once
+
+#include <cstdint>
+
+// Fixed-size sliding window of samples, with incremental mean, min and max.
+// Min and max use monotonic queues of sample numbers, so push() is amortised O(1).
+template <int N>
+class SlidingWindow
+{
+  public:
+	void push(double value)
+	{
+		uint64_t number = count++;
+		if (count > N)
+			sum -= samples[number % N];
+		samples[number % N] = value;
+		sum += value;
+
+		// drop samples leaving the window, then those dominated by the new one
+		uint64_t oldest = (count > N) ? count - N : 0;
+		while (minSize > 0 && minQ[minHead] < oldest)
+			minHead = (minHead + 1) % N, minSize--;
+		while (maxSize > 0 && maxQ[maxHead] < oldest)
+			maxHead = (maxHead + 1) % N, maxSize--;
+		while (minSize > 0 && samples[minQ[(minHead + minSize - 1) % N] % N] >= value)
+			minSize--;
+		while (maxSize > 0 && samples[maxQ[(maxHead + maxSize - 1) % N] % N] <= value)
+			maxSize--;
+		minQ[(minHead + minSize++) % N] = number;
+		maxQ[(maxHead + maxSize++) % N] = number;
+	}
+
+	bool empty() const { return count == 0; }
+	int size() const { return count < N ? static_cast<int>(count) : N; }
+	double last() const { return samples[(count - 1) % N]; }
+	double mean() const { return sum / size(); }
+	double min() const { return samples[minQ[minHead] % N]; }
+	double max() const { return samples[maxQ[maxHead] % N]; }
+
+	void clear()
+	{
+		count = 0;
+		sum = 0;
+		minHead = minSize = maxHead = maxSize = 0;
+	}
+
+  private:
+	double samples[N] {};
+	uint64_t count = 0;
+	double sum = 0;
+	uint64_t minQ[N] {}, maxQ[N] {};
+	int minHead = 0, minSize = 0;
+	int maxHead = 0, maxSize = 0;
+};